@@ -253,6 +253,7 @@ fi
 Log "================================================================"
 
 LIB_M='-lm'
+LIB_PTHREAD='-lpthread'
 
 if [ $IsBuildEnabled -eq 1 ]; then
   if [ $IsOSLinux -eq 0 ]; then
@@ -270,8 +271,6 @@ if [ $IsBuildEnabled -eq 1 ]; then
     #  /'\_   _/`\
     #  \___)=(___/
     ################################################################
-    LIB_PTHREAD='-lpthread'
-
     INC_LIBURING=$(pkg-config --cflags liburing)
     LIB_LIBURING=$(pkg-config --libs liburing)
 
@@ -1,60 +1,208 @@
+#pragma once
+
+#include <sys/uio.h>
+
 #include "memory.h"
 #include "text.h"
 
+/*
+ * Appends formatted values into outBuffer.
+ *
+ * When outBuffer is full and arena is set, rest spills into chunks pushed
+ * from arena. Chunks are chained, never moved, so whole output can be
+ * transmitted without copying with StringBuilderFlushIovec().
+ * When there is no room left, output is cut and isTruncated is set. Flush
+ * then ends output with STRING_BUILDER_TRUNCATED_MARKER, so reader can tell.
+ *
+ * @code
+ *   struct memory_temp temp = MemoryTempBegin(arena);
+ *   stringBuilder->arena = temp.arena;
+ *   StringBuilderAppend..(stringBuilder, x);
+ *   struct iovec iovecs[8];
+ *   u32 iovecCount = StringBuilderFlushIovec(stringBuilder, iovecs, 8);
+ *   writev(fd, iovecs, iovecCount);
+ *   MemoryTempEnd(&temp);
+ * @endcode
+ */
+
+struct string_builder_chunk {
+  struct string_builder_chunk *next;
+  u64 length;
+  u64 capacity;
+  u8 value[];
+};
+
+// minimum size of chunk pushed from arena
+#define STRING_BUILDER_CHUNK_SIZE 4096
+// replaces end of cut output, output is mostly lines so it ends line too
+#define STRING_BUILDER_TRUNCATED_MARKER "...\n"
+
 struct string_builder {
   struct string *outBuffer;
   struct string *stringBuffer;
+  // bytes used in outBuffer
   u64 length;
+
+  // optional, where chunks are pushed when outBuffer is full
+  struct memory_arena *arena;
+  struct string_builder_chunk *firstChunk;
+  struct string_builder_chunk *lastChunk;
+
+  // some output was lost, cleared on flush
+  b8 isTruncated : 1;
 };
 
+/*
+ * @return chunk that can hold at least one byte, 0 when arena is full
+ */
+static inline struct string_builder_chunk *
+StringBuilderGetChunk(struct string_builder *stringBuilder, u64 size)
+{
+  struct string_builder_chunk *chunk = stringBuilder->lastChunk;
+  if (chunk && chunk->length < chunk->capacity)
+    return chunk;
+
+  struct memory_arena *arena = stringBuilder->arena;
+  if (!arena)
+    return 0;
+
+  u64 capacity = size < STRING_BUILDER_CHUNK_SIZE ? STRING_BUILDER_CHUNK_SIZE : size;
+  u64 alignment = sizeof(void *);
+  // worst case alignment padding
+  u64 available = arena->total - arena->used;
+  if (available <= sizeof(*chunk) + alignment)
+    return 0;
+  if (available - sizeof(*chunk) - alignment < capacity) {
+    // take whatever is left
+    capacity = available - sizeof(*chunk) - alignment;
+  }
+
+  chunk = MemoryArenaPush(arena, sizeof(*chunk) + capacity, alignment);
+  if (!chunk)
+    return 0;
+  *chunk = (struct string_builder_chunk){.capacity = capacity};
+  if (stringBuilder->lastChunk)
+    stringBuilder->lastChunk->next = chunk;
+  else
+    stringBuilder->firstChunk = chunk;
+  stringBuilder->lastChunk = chunk;
+  return chunk;
+}
+
 static inline void
-StringBuilderAppendString(struct string_builder *stringBuilder, struct string *string)
+StringBuilderAppendBytes(struct string_builder *stringBuilder, u8 *value, u64 length)
 {
+  // - fill outBuffer
+  // once chunks are used outBuffer is full, so order is kept
   struct string *outBuffer = stringBuilder->outBuffer;
-  memcpy(outBuffer->value + stringBuilder->length, string->value, string->length);
-  stringBuilder->length += string->length;
-  debug_assert(stringBuilder->length <= outBuffer->length);
+  if (!stringBuilder->lastChunk) {
+    u64 available = outBuffer->length - stringBuilder->length;
+    u64 copyLength = length < available ? length : available;
+    memcpy(outBuffer->value + stringBuilder->length, value, copyLength);
+    stringBuilder->length += copyLength;
+    value += copyLength;
+    length -= copyLength;
+  }
+
+  // - spill rest into chunks
+  while (length != 0) {
+    struct string_builder_chunk *chunk = StringBuilderGetChunk(stringBuilder, length);
+    if (!chunk) {
+      stringBuilder->isTruncated = 1;
+      return;
+    }
+
+    u64 available = chunk->capacity - chunk->length;
+    u64 copyLength = length < available ? length : available;
+    memcpy(chunk->value + chunk->length, value, copyLength);
+    chunk->length += copyLength;
+    value += copyLength;
+    length -= copyLength;
+  }
+}
+
+static inline void
+StringBuilderAppendString(struct string_builder *stringBuilder, struct string *string)
+{
+  StringBuilderAppendBytes(stringBuilder, string->value, string->length);
 }
 
 static inline void
 StringBuilderAppendU64(struct string_builder *stringBuilder, u64 value)
 {
-  struct string *outBuffer = stringBuilder->outBuffer;
   struct string *stringBuffer = stringBuilder->stringBuffer;
-
   struct string string = FormatU64(stringBuffer, value);
-  memcpy(outBuffer->value + stringBuilder->length, string.value, string.length);
-  stringBuilder->length += string.length;
-  debug_assert(stringBuilder->length <= outBuffer->length);
+  StringBuilderAppendString(stringBuilder, &string);
 }
 
 static inline void
 StringBuilderAppendHex(struct string_builder *stringBuilder, u64 value)
 {
-  struct string *outBuffer = stringBuilder->outBuffer;
   struct string *stringBuffer = stringBuilder->stringBuffer;
-
   struct string string = FormatHex(stringBuffer, value);
-  memcpy(outBuffer->value + stringBuilder->length, string.value, string.length);
-  stringBuilder->length += string.length;
-  debug_assert(stringBuilder->length <= outBuffer->length);
+  StringBuilderAppendString(stringBuilder, &string);
 }
 
 static inline void
 StringBuilderAppendF32(struct string_builder *stringBuilder, f32 value, u32 fractionCount)
 {
-  struct string *outBuffer = stringBuilder->outBuffer;
   struct string *stringBuffer = stringBuilder->stringBuffer;
-
   struct string string = FormatF32(stringBuffer, value, fractionCount);
-  memcpy(outBuffer->value + stringBuilder->length, string.value, string.length);
-  stringBuilder->length += string.length;
-  debug_assert(stringBuilder->length <= outBuffer->length);
+  StringBuilderAppendString(stringBuilder, &string);
+}
+
+/*
+ * @return total bytes appended since last flush
+ */
+static inline u64
+StringBuilderLength(struct string_builder *stringBuilder)
+{
+  u64 length = stringBuilder->length;
+  for (struct string_builder_chunk *chunk = stringBuilder->firstChunk; chunk; chunk = chunk->next)
+    length += chunk->length;
+  return length;
+}
+
+/*
+ * @return iovecs needed by StringBuilderFlushIovec()
+ */
+static inline u32
+StringBuilderIovecCount(struct string_builder *stringBuilder)
+{
+  u32 count = stringBuilder->length != 0;
+  for (struct string_builder_chunk *chunk = stringBuilder->firstChunk; chunk; chunk = chunk->next)
+    count++;
+  return count;
+}
+
+/*
+ * Overwrites end of last written bytes with marker when output was cut.
+ */
+static inline void
+StringBuilderMarkTruncated(struct string_builder *stringBuilder)
+{
+  if (!stringBuilder->isTruncated)
+    return;
+
+  struct string marker = STRING_FROM_ZERO_TERMINATED(STRING_BUILDER_TRUNCATED_MARKER);
+  u8 *end = stringBuilder->outBuffer->value + stringBuilder->length;
+  u64 length = stringBuilder->length;
+  struct string_builder_chunk *chunk = stringBuilder->lastChunk;
+  if (chunk) {
+    end = chunk->value + chunk->length;
+    length = chunk->length;
+  }
+  // too small to hold marker, output is kept as it is
+  if (length < marker.length)
+    return;
+  memcpy(end - marker.length, marker.value, marker.length);
 }
 
 /*
  * Returns string that is ready for transmit.
  * Also resets length of builder.
+ * Only outBuffer is returned, use StringBuilderFlushIovec() when builder has
+ * arena.
  *
  * @code
  *   StringBuilderAppend..(stringBuilder, x);
@@ -65,8 +213,46 @@ StringBuilderAppendF32(struct string_builder *stringBuilder, f32 value, u32 frac
 static inline struct string
 StringBuilderFlush(struct string_builder *stringBuilder)
 {
+  debug_assert(stringBuilder->firstChunk == 0);
+  StringBuilderMarkTruncated(stringBuilder);
   struct string *outBuffer = stringBuilder->outBuffer;
   struct string result = (struct string){.value = outBuffer->value, .length = stringBuilder->length};
   stringBuilder->length = 0;
+  stringBuilder->isTruncated = 0;
   return result;
 }
+
+/*
+ * Fills iovecs with outBuffer and every chunk, then resets builder.
+ * Chunks stay valid until their arena memory is released.
+ *
+ * @return number of iovecs used
+ */
+static inline u32
+StringBuilderFlushIovec(struct string_builder *stringBuilder, struct iovec *iovecs, u32 iovecMax)
+{
+  StringBuilderMarkTruncated(stringBuilder);
+  u32 iovecCount = 0;
+  if (stringBuilder->length != 0 && iovecCount < iovecMax) {
+    iovecs[iovecCount] = (struct iovec){
+        .iov_base = stringBuilder->outBuffer->value,
+        .iov_len = stringBuilder->length,
+    };
+    iovecCount++;
+  }
+
+  for (struct string_builder_chunk *chunk = stringBuilder->firstChunk; chunk; chunk = chunk->next) {
+    // caller must give enough iovecs, see StringBuilderIovecCount()
+    debug_assert(iovecCount < iovecMax);
+    if (iovecCount == iovecMax)
+      break;
+    iovecs[iovecCount] = (struct iovec){.iov_base = chunk->value, .iov_len = chunk->length};
+    iovecCount++;
+  }
+
+  stringBuilder->length = 0;
+  stringBuilder->firstChunk = 0;
+  stringBuilder->lastChunk = 0;
+  stringBuilder->isTruncated = 0;
+  return iovecCount;
+}
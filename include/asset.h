@@ -0,0 +1,291 @@
+#pragma once
+
+#include "assert.h"
+#include "job.h"
+#include "memory.h"
+#include "text.h"
+#include "type.h"
+
+/*
+ * Loads assets without stalling game loop.
+ *
+ * Platform layer reads file into loader memory, decoding runs on job queue.
+ * Workers push finished assets to completion list and game loop takes them
+ * from there, so it never waits for disk or decoder.
+ *
+ * @code
+ *   AssetLoaderInit(loader, memory);
+ *   struct asset *asset = AssetLoaderAdd(loader, &path);
+ *   // platform layer
+ *   u8 *file = AssetLoaderPushFile(loader, asset, fileSize);
+ *   .. read fileSize bytes into file ..
+ *   AssetLoaderDecode(loader, asset, queue);
+ *   ..
+ *   // game loop, after onComplete is called
+ *   struct asset *asset = AssetLoaderTakeCompleted(loader);
+ *   for (; asset; asset = asset->next)
+ *     if (asset->state == ASSET_STATE_READY) ..
+ * @endcode
+ *
+ * Only images in binary PPM (P6) format are decoded for now.
+ */
+
+#define ASSET_MAX 64
+// larger images are refused, so their size cannot overflow
+#define ASSET_IMAGE_SIZE_MAX 16384
+
+enum asset_state {
+  ASSET_STATE_NONE,
+  // platform layer is reading file
+  ASSET_STATE_READING,
+  // file is in memory, worker is decoding it
+  ASSET_STATE_DECODING,
+  ASSET_STATE_READY,
+  ASSET_STATE_FAILED,
+};
+
+struct image {
+  u32 width;
+  u32 height;
+  // 0xRRGGBB, same as framebuffer
+  u32 *pixels;
+};
+
+struct asset_loader;
+struct asset {
+  // must be first, see AssetDecode()
+  struct job job;
+  struct asset_loader *loader;
+  // next in completion list
+  struct asset *next;
+  // zero terminated
+  struct string path;
+  enum asset_state state;
+  // contents of file, filled by platform layer
+  u8 *file;
+  u64 fileSize;
+  // where pixels start in file
+  u64 pixelOffset;
+  struct image image;
+};
+
+typedef void (*asset_loader_complete_fn)(struct asset_loader *loader);
+
+struct asset_loader {
+  struct asset assets[ASSET_MAX];
+  u32 assetCount;
+  // holds paths, files and decoded assets, only game loop pushes into it
+  struct memory_arena memory;
+  // assets that are decoding
+  struct job_counter decodeCounter;
+  // decoded or failed assets, newest first
+  struct asset *completed;
+  // called by thread that completed asset, may be 0
+  asset_loader_complete_fn onComplete;
+};
+
+static void AssetLoaderInit(struct asset_loader *loader,
+                            struct memory_arena memory) {
+  loader->assetCount = 0;
+  loader->memory = memory;
+  loader->decodeCounter = (struct job_counter){};
+  loader->completed = 0;
+}
+
+/*
+ * @return 0 when it does not fit into loader memory
+ */
+static void *AssetLoaderPush(struct asset_loader *loader, u64 size) {
+  struct memory_arena *memory = &loader->memory;
+  // alignment may waste up to 63 bytes
+  if (size > memory->total || memory->used + 63 > memory->total - size)
+    return 0;
+  return MemoryArenaPush(memory, size, 64);
+}
+
+/*
+ * @param path copied into loader memory
+ * @return 0 when loader is full
+ */
+static struct asset *AssetLoaderAdd(struct asset_loader *loader,
+                                    struct string *path) {
+  if (loader->assetCount == ASSET_MAX)
+    return 0;
+
+  u8 *pathValue = AssetLoaderPush(loader, path->length + 1);
+  if (!pathValue)
+    return 0;
+  memcpy(pathValue, path->value, path->length);
+  pathValue[path->length] = 0;
+
+  struct asset *asset = loader->assets + loader->assetCount;
+  loader->assetCount++;
+  *asset = (struct asset){
+      .loader = loader,
+      .path = {.value = pathValue, .length = path->length},
+      .state = ASSET_STATE_READING,
+  };
+  return asset;
+}
+
+/*
+ * @return memory that file must be read into, 0 when it does not fit
+ */
+static u8 *AssetLoaderPushFile(struct asset_loader *loader,
+                               struct asset *asset, u64 fileSize) {
+  debug_assert(asset->state == ASSET_STATE_READING);
+  asset->file = AssetLoaderPush(loader, fileSize == 0 ? 1 : fileSize);
+  asset->fileSize = asset->file ? fileSize : 0;
+  return asset->file;
+}
+
+/*
+ * Called by any thread.
+ */
+static void AssetLoaderComplete(struct asset_loader *loader,
+                                struct asset *asset, enum asset_state state) {
+  asset->state = state;
+  struct asset *head = __atomic_load_n(&loader->completed, __ATOMIC_RELAXED);
+  do {
+    asset->next = head;
+  } while (!__atomic_compare_exchange_n(&loader->completed, &head, asset, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+  if (loader->onComplete)
+    loader->onComplete(loader);
+}
+
+/*
+ * Takes every asset completed so far.
+ * @return list linked with asset->next, 0 when there is none
+ */
+static inline struct asset *
+AssetLoaderTakeCompleted(struct asset_loader *loader) {
+  return __atomic_exchange_n(&loader->completed, 0, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Reads number in PPM header, skipping whitespace and comments before it.
+ * @return 0 when there is no number
+ */
+static b8 AssetPpmParseNumber(u8 *file, u64 fileSize, u64 *offset,
+                              u64 *value) {
+  u64 index = *offset;
+  while (index < fileSize) {
+    u8 character = file[index];
+    if (character == '#') {
+      while (index < fileSize && file[index] != '\n')
+        index++;
+    } else if (character == ' ' || character == '\t' || character == '\n' ||
+               character == '\r') {
+      index++;
+    } else {
+      break;
+    }
+  }
+
+  struct string number = {.value = file + index};
+  while (index < fileSize && file[index] >= '0' && file[index] <= '9') {
+    number.length++;
+    index++;
+  }
+  if (number.length == 0 || !ParseU64(&number, value))
+    return 0;
+
+  *offset = index;
+  return 1;
+}
+
+/*
+ * Parses header of binary PPM with 8 bit channels.
+ * @return 0 when file is not one
+ */
+static b8 AssetImageParseHeader(u8 *file, u64 fileSize, struct image *image,
+                                u64 *pixelOffset) {
+  if (fileSize < 2 || file[0] != 'P' || file[1] != '6')
+    return 0;
+
+  u64 offset = 2;
+  u64 width;
+  u64 height;
+  u64 maxValue;
+  if (!AssetPpmParseNumber(file, fileSize, &offset, &width) ||
+      !AssetPpmParseNumber(file, fileSize, &offset, &height) ||
+      !AssetPpmParseNumber(file, fileSize, &offset, &maxValue))
+    return 0;
+
+  if (width == 0 || width > ASSET_IMAGE_SIZE_MAX || height == 0 ||
+      height > ASSET_IMAGE_SIZE_MAX || maxValue != 255)
+    return 0;
+
+  // exactly one whitespace separates header from pixels
+  if (offset == fileSize)
+    return 0;
+  offset++;
+
+  if (fileSize - offset < width * height * 3)
+    return 0;
+
+  image->width = (u32)width;
+  image->height = (u32)height;
+  *pixelOffset = offset;
+  return 1;
+}
+
+static void AssetDecode(struct job *job) {
+  struct asset *asset = (struct asset *)job;
+  struct image *image = &asset->image;
+  u8 *rgb = asset->file + asset->pixelOffset;
+  u64 pixelCount = (u64)image->width * image->height;
+  for (u64 index = 0; index < pixelCount; index++) {
+    image->pixels[index] = (u32)rgb[0] << 16 | (u32)rgb[1] << 8 | rgb[2];
+    rgb += 3;
+  }
+
+  // leave counter before asset is published, game loop that took it may
+  // reset loader right away
+  struct asset_loader *loader = asset->loader;
+  __atomic_sub_fetch(&loader->decodeCounter.pending, 1, __ATOMIC_ACQ_REL);
+  AssetLoaderComplete(loader, asset, ASSET_STATE_READY);
+}
+
+/*
+ * Called by game loop when whole file is in memory. Decoding runs on
+ * workers, asset is completed as failed right away when file is not valid.
+ */
+static void AssetLoaderDecode(struct asset_loader *loader, struct asset *asset,
+                              struct job_queue *queue) {
+  debug_assert(asset->state == ASSET_STATE_READING);
+  struct image *image = &asset->image;
+  if (!AssetImageParseHeader(asset->file, asset->fileSize, image,
+                             &asset->pixelOffset)) {
+    AssetLoaderComplete(loader, asset, ASSET_STATE_FAILED);
+    return;
+  }
+
+  // memory is pushed here, workers must not touch arena
+  image->pixels = AssetLoaderPush(
+      loader, sizeof(*image->pixels) * image->width * image->height);
+  if (!image->pixels) {
+    AssetLoaderComplete(loader, asset, ASSET_STATE_FAILED);
+    return;
+  }
+
+  asset->state = ASSET_STATE_DECODING;
+  // counted by AssetDecode() itself, JobRun() would count after publishing
+  asset->job = (struct job){.work = AssetDecode};
+  JobCounterAdd(&loader->decodeCounter, 1);
+  JobQueuePush(queue, &asset->job);
+  JobQueueWake(queue);
+}
+
+/*
+ * Forgets every asset and frees their memory, e.g. on level change.
+ * Nothing must be reading or decoding.
+ */
+static void AssetLoaderReset(struct asset_loader *loader) {
+  debug_assert(IsJobCounterDone(&loader->decodeCounter));
+  loader->assetCount = 0;
+  loader->memory.used = 0;
+  loader->completed = 0;
+}
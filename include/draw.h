@@ -0,0 +1,416 @@
+#pragma once
+
+#include <immintrin.h>
+
+#include "assert.h"
+#include "type.h"
+
+struct rect {
+  u16 x;
+  u16 y;
+  u16 width;
+  u16 height;
+};
+
+static inline b8 IsRectEmpty(struct rect rect) {
+  return rect.width == 0 || rect.height == 0;
+}
+
+static inline u64 RectArea(struct rect rect) {
+  return (u64)rect.width * (u64)rect.height;
+}
+
+static inline struct rect RectUnion(struct rect left, struct rect right) {
+  u32 x0 = left.x < right.x ? left.x : right.x;
+  u32 y0 = left.y < right.y ? left.y : right.y;
+  u32 leftX1 = (u32)left.x + left.width;
+  u32 rightX1 = (u32)right.x + right.width;
+  u32 leftY1 = (u32)left.y + left.height;
+  u32 rightY1 = (u32)right.y + right.height;
+  u32 x1 = leftX1 > rightX1 ? leftX1 : rightX1;
+  u32 y1 = leftY1 > rightY1 ? leftY1 : rightY1;
+  return (struct rect){
+      .x = (u16)x0,
+      .y = (u16)y0,
+      .width = (u16)(x1 - x0),
+      .height = (u16)(y1 - y0),
+  };
+}
+
+static inline struct rect RectIntersect(struct rect left, struct rect right) {
+  u32 x0 = left.x > right.x ? left.x : right.x;
+  u32 y0 = left.y > right.y ? left.y : right.y;
+  u32 leftX1 = (u32)left.x + left.width;
+  u32 rightX1 = (u32)right.x + right.width;
+  u32 leftY1 = (u32)left.y + left.height;
+  u32 rightY1 = (u32)right.y + right.height;
+  u32 x1 = leftX1 < rightX1 ? leftX1 : rightX1;
+  u32 y1 = leftY1 < rightY1 ? leftY1 : rightY1;
+  if (x0 >= x1 || y0 >= y1)
+    return (struct rect){};
+  return (struct rect){
+      .x = (u16)x0,
+      .y = (u16)y0,
+      .width = (u16)(x1 - x0),
+      .height = (u16)(y1 - y0),
+  };
+}
+
+/*
+ * List of dirty rectangles.
+ * Rectangles are coalesced while adding, so it never overflows. When it is
+ * full, new rectangle is merged into the one that grows the least.
+ */
+#define DAMAGE_RECT_MAX 16
+struct damage {
+  struct rect rects[DAMAGE_RECT_MAX];
+  u32 count;
+};
+
+static inline void DamageReset(struct damage *damage) { damage->count = 0; }
+
+static inline void DamageRemoveAt(struct damage *damage, u32 index) {
+  damage->count--;
+  damage->rects[index] = damage->rects[damage->count];
+}
+
+static inline void DamageAdd(struct damage *damage, struct rect rect) {
+  if (IsRectEmpty(rect))
+    return;
+
+merge:
+  for (u32 index = 0; index < damage->count; index++) {
+    struct rect existing = damage->rects[index];
+    struct rect merged = RectUnion(existing, rect);
+    // merge when union does not cover more than what two would cover
+    // e.g. overlapping or touching rects with same span
+    if (RectArea(merged) <= RectArea(existing) + RectArea(rect)) {
+      DamageRemoveAt(damage, index);
+      rect = merged;
+      goto merge;
+    }
+  }
+
+  if (damage->count == DAMAGE_RECT_MAX) {
+    u32 bestIndex = 0;
+    u64 bestGrowth = (u64)-1;
+    for (u32 index = 0; index < damage->count; index++) {
+      struct rect existing = damage->rects[index];
+      u64 growth = RectArea(RectUnion(existing, rect)) - RectArea(existing);
+      if (growth < bestGrowth) {
+        bestGrowth = growth;
+        bestIndex = index;
+      }
+    }
+
+    rect = RectUnion(damage->rects[bestIndex], rect);
+    DamageRemoveAt(damage, bestIndex);
+    goto merge;
+  }
+
+  damage->rects[damage->count] = rect;
+  damage->count++;
+}
+
+static inline void DamageUnion(struct damage *damage, struct damage *other) {
+  for (u32 index = 0; index < other->count; index++)
+    DamageAdd(damage, other->rects[index]);
+}
+
+struct framebuffer {
+  u16 width;
+  u16 height;
+  u16 stride;
+  u8 *data;
+  // regions changed by whole framebuffer Draw calls since last reset
+  struct damage damage;
+};
+
+/*
+ * Fills count pixels starting at pixel with color.
+ * Wide paths use non-temporal stores for spans that are long enough to not
+ * fit in cache, so callers must issue DrawFence() after the last fill of a
+ * pass and before handing the buffer to someone else.
+ */
+// 64 KiB, short runs (e.g. checkers) stay in cache
+#define FILL_SPAN_STREAM_THRESHOLD (1 << 14)
+
+typedef void (*fill_span_fn)(u32 *pixel, u64 count, u32 color);
+
+static inline void FillSpanScalar(u32 *pixel, u64 count, u32 color) {
+  while (count--) {
+    *pixel = color;
+    pixel++;
+  }
+}
+
+__attribute__((target("sse2"))) static inline void
+FillSpanSSE2(u32 *pixel, u64 count, u32 color) {
+  // - align to 16 bytes
+  while (count && ((u64)pixel & 15)) {
+    *pixel = color;
+    pixel++;
+    count--;
+  }
+
+  __m128i value = _mm_set1_epi32((int)color);
+  if (count >= FILL_SPAN_STREAM_THRESHOLD) {
+    while (count >= 16) {
+      _mm_stream_si128((__m128i *)pixel + 0, value);
+      _mm_stream_si128((__m128i *)pixel + 1, value);
+      _mm_stream_si128((__m128i *)pixel + 2, value);
+      _mm_stream_si128((__m128i *)pixel + 3, value);
+      pixel += 16;
+      count -= 16;
+    }
+  }
+
+  while (count >= 16) {
+    _mm_store_si128((__m128i *)pixel + 0, value);
+    _mm_store_si128((__m128i *)pixel + 1, value);
+    _mm_store_si128((__m128i *)pixel + 2, value);
+    _mm_store_si128((__m128i *)pixel + 3, value);
+    pixel += 16;
+    count -= 16;
+  }
+
+  while (count >= 4) {
+    _mm_store_si128((__m128i *)pixel, value);
+    pixel += 4;
+    count -= 4;
+  }
+
+  FillSpanScalar(pixel, count, color);
+}
+
+__attribute__((target("avx2"))) static inline void
+FillSpanAVX2(u32 *pixel, u64 count, u32 color) {
+  // - align to 32 bytes
+  while (count && ((u64)pixel & 31)) {
+    *pixel = color;
+    pixel++;
+    count--;
+  }
+
+  __m256i value = _mm256_set1_epi32((int)color);
+  if (count >= FILL_SPAN_STREAM_THRESHOLD) {
+    while (count >= 32) {
+      _mm256_stream_si256((__m256i *)pixel + 0, value);
+      _mm256_stream_si256((__m256i *)pixel + 1, value);
+      _mm256_stream_si256((__m256i *)pixel + 2, value);
+      _mm256_stream_si256((__m256i *)pixel + 3, value);
+      pixel += 32;
+      count -= 32;
+    }
+  }
+
+  while (count >= 32) {
+    _mm256_store_si256((__m256i *)pixel + 0, value);
+    _mm256_store_si256((__m256i *)pixel + 1, value);
+    _mm256_store_si256((__m256i *)pixel + 2, value);
+    _mm256_store_si256((__m256i *)pixel + 3, value);
+    pixel += 32;
+    count -= 32;
+  }
+
+  while (count >= 8) {
+    _mm256_store_si256((__m256i *)pixel, value);
+    pixel += 8;
+    count -= 8;
+  }
+
+  FillSpanScalar(pixel, count, color);
+}
+
+static fill_span_fn FillSpan = FillSpanScalar;
+
+/*
+ * Selects widest fill kernel that cpu supports.
+ * Must be called once at startup before any Draw call.
+ */
+static inline void DrawInit(void) {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    FillSpan = FillSpanAVX2;
+  else if (__builtin_cpu_supports("sse2"))
+    FillSpan = FillSpanSSE2;
+  else
+    FillSpan = FillSpanScalar;
+}
+
+/*
+ * Makes non-temporal stores globally visible.
+ */
+static inline void DrawFence(void) { _mm_sfence(); }
+
+static inline u8 *FramebufferGetPixelAt(struct framebuffer *framebuffer,
+                                        u16 x, u16 y) {
+  return framebuffer->data + (u64)y * framebuffer->stride +
+         (u64)x * sizeof(u32);
+}
+
+/*
+ * Clips rect to framebuffer bounds.
+ */
+static inline struct rect FramebufferClipRect(struct framebuffer *framebuffer,
+                                              struct rect rect) {
+  if (rect.x >= framebuffer->width || rect.y >= framebuffer->height)
+    return (struct rect){};
+
+  if (rect.width > framebuffer->width - rect.x)
+    rect.width = framebuffer->width - rect.x;
+  if (rect.height > framebuffer->height - rect.y)
+    rect.height = framebuffer->height - rect.y;
+  return rect;
+}
+
+/*
+ * Rect variants do not record damage, so they can be called from many threads
+ * on disjoint rects of same framebuffer.
+ */
+static inline void DrawSolidRect(struct framebuffer *framebuffer,
+                                 struct rect rect, u32 color) {
+  rect = FramebufferClipRect(framebuffer, rect);
+  u16 stride = framebuffer->stride;
+  u8 *row = FramebufferGetPixelAt(framebuffer, rect.x, rect.y);
+
+  if (rect.width == framebuffer->width &&
+      stride == rect.width * sizeof(u32)) {
+    // rows are contiguous, fill whole rect as one span
+    FillSpan((u32 *)row, (u64)rect.width * rect.height, color);
+  } else {
+    for (u16 y = 0; y < rect.height; y++) {
+      FillSpan((u32 *)row, rect.width, color);
+      row += stride;
+    }
+  }
+
+  DrawFence();
+}
+
+static inline void DrawSolid(struct framebuffer *framebuffer, u32 color) {
+  struct rect rect = {.width = framebuffer->width,
+                      .height = framebuffer->height};
+  DrawSolidRect(framebuffer, rect, color);
+  DamageAdd(&framebuffer->damage, rect);
+}
+
+#define CHECKER_SIZE_IN_PIXELS 350
+
+/*
+ * @return horizontal scroll of checkers in pixels, wrapped to one period
+ */
+static inline u32 CheckerBoardXOffset(f32 offset) {
+  return (u32)(offset * 10.0f) % (CHECKER_SIZE_IN_PIXELS * 2);
+}
+
+/*
+ * Draws part of checkers, that are scrolled to left by offset, which falls
+ * into rect.
+ *
+ * Every row is made of alternating constant color runs, so each run is filled
+ * with one FillSpan call instead of deciding color per pixel.
+ */
+static inline void DrawCheckerBoardRect(struct framebuffer *framebuffer,
+                                        struct rect rect, u32 lightColor,
+                                        u32 darkColor, f32 offset) {
+  rect = FramebufferClipRect(framebuffer, rect);
+  u16 stride = framebuffer->stride;
+  u8 *row = FramebufferGetPixelAt(framebuffer, rect.x, rect.y);
+
+  u32 checkerSizeInPixels = CHECKER_SIZE_IN_PIXELS;
+  u32 period = checkerSizeInPixels * 2;
+  u32 xOffset = (CheckerBoardXOffset(offset) + rect.x) % period;
+
+  b8 isOddRow = (rect.y / checkerSizeInPixels) & 1;
+  u32 yInChecker = rect.y % checkerSizeInPixels;
+  for (u16 y = 0; y < rect.height; y++) {
+    u32 *pixel = (u32 *)row;
+
+    // first run may be partial
+    b8 isOddColumn = xOffset >= checkerSizeInPixels;
+    u32 runLength = period - xOffset;
+    if (!isOddColumn)
+      runLength -= checkerSizeInPixels;
+
+    u32 remaining = rect.width;
+    while (remaining) {
+      if (runLength > remaining)
+        runLength = remaining;
+
+      u32 color = (isOddRow ^ isOddColumn) ? lightColor : darkColor;
+      FillSpan(pixel, runLength, color);
+
+      pixel += runLength;
+      remaining -= runLength;
+      isOddColumn ^= 1;
+      runLength = checkerSizeInPixels;
+    }
+
+    yInChecker++;
+    if (yInChecker == checkerSizeInPixels) {
+      yInChecker = 0;
+      isOddRow ^= 1;
+    }
+
+    row += stride;
+  }
+
+  DrawFence();
+}
+
+static inline void DrawCheckerBoard(struct framebuffer *framebuffer,
+                                    u32 lightColor, u32 darkColor,
+                                    f32 offset) {
+  struct rect rect = {.width = framebuffer->width,
+                      .height = framebuffer->height};
+  DrawCheckerBoardRect(framebuffer, rect, lightColor, darkColor, offset);
+  DamageAdd(&framebuffer->damage, rect);
+}
+
+/*
+ * Records only columns that change when checkers scroll from previousOffset
+ * to offset. Scrolling by d pixels moves every vertical checker edge by d, so
+ * only a d pixels wide strip next to each edge changes color.
+ */
+static inline void DrawCheckerBoardDamage(struct framebuffer *framebuffer,
+                                          f32 previousOffset, f32 offset) {
+  u32 checkerSizeInPixels = CHECKER_SIZE_IN_PIXELS;
+  u32 period = checkerSizeInPixels * 2;
+  u32 previousXOffset = CheckerBoardXOffset(previousOffset);
+  u32 xOffset = CheckerBoardXOffset(offset);
+  u32 distance = (xOffset + period - previousXOffset) % period;
+  if (distance == 0)
+    return;
+
+  if (distance >= checkerSizeInPixels) {
+    struct rect rect = {.width = framebuffer->width,
+                        .height = framebuffer->height};
+    DamageAdd(&framebuffer->damage, rect);
+    return;
+  }
+
+  // column i shows pattern at i + xOffset, it changes when an edge at
+  // pattern position e lies in (i + previousXOffset, i + previousXOffset + d]
+  u32 firstEdge =
+      (previousXOffset / checkerSizeInPixels + 1) * checkerSizeInPixels;
+  for (u32 edge = firstEdge;
+       edge < previousXOffset + distance + framebuffer->width;
+       edge += checkerSizeInPixels) {
+    s64 x0 = (s64)edge - previousXOffset - distance;
+    s64 x1 = (s64)edge - previousXOffset;
+    if (x0 < 0)
+      x0 = 0;
+    if (x1 > framebuffer->width)
+      x1 = framebuffer->width;
+    if (x0 >= x1)
+      continue;
+
+    struct rect rect = {
+        .x = (u16)x0,
+        .width = (u16)(x1 - x0),
+        .height = framebuffer->height,
+    };
+    DamageAdd(&framebuffer->damage, rect);
+  }
+}
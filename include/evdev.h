@@ -0,0 +1,201 @@
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libevdev/libevdev.h>
+#include <unistd.h>
+
+#include "input.h"
+#include "type.h"
+
+/*
+ * Reads devices under /dev/input directly, without waiting for compositor
+ * to forward them.
+ *
+ * Device fd is non blocking. Owner polls it, and on POLLIN drains every
+ * pending event into input.
+ *
+ * @code
+ *   struct evdev_device device;
+ *   if (EvdevDeviceOpen(&device, path, EVDEV_DEVICE_GAMEPAD)) {
+ *     poll device.fd
+ *     if (!EvdevDeviceRead(&device, input))
+ *       EvdevDeviceClose(&device);
+ *   }
+ * @endcode
+ */
+
+enum evdev_device_kind {
+  EVDEV_DEVICE_GAMEPAD = 1 << 0,
+  EVDEV_DEVICE_KEYBOARD = 1 << 1,
+};
+
+struct evdev_device {
+  struct libevdev *libevdev;
+  s32 fd;
+  // enum evdev_device_kind
+  u32 kind;
+  // range of left stick, used for mapping it to [-1, 1]
+  s32 stickMin[2];
+  s32 stickMax[2];
+};
+
+static inline u32 EvdevDeviceKind(struct libevdev *libevdev) {
+  if (libevdev_has_event_code(libevdev, EV_KEY, BTN_GAMEPAD))
+    return EVDEV_DEVICE_GAMEPAD;
+  // mice and power buttons also report EV_KEY
+  if (libevdev_has_event_code(libevdev, EV_KEY, KEY_A) &&
+      libevdev_has_event_code(libevdev, EV_KEY, KEY_SPACE))
+    return EVDEV_DEVICE_KEYBOARD;
+  return 0;
+}
+
+/*
+ * @param kinds devices to accept, bitmask of enum evdev_device_kind
+ * @return 0 when device cannot be opened or is not one of kinds
+ */
+static b8 EvdevDeviceOpen(struct evdev_device *device, const char *path,
+                          u32 kinds) {
+  *device = (struct evdev_device){.fd = -1};
+
+  s32 fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd == -1)
+    return 0;
+
+  struct libevdev *libevdev;
+  if (libevdev_new_from_fd(fd, &libevdev) != 0) {
+    close(fd);
+    return 0;
+  }
+
+  u32 kind = EvdevDeviceKind(libevdev) & kinds;
+  if (kind == 0) {
+    libevdev_free(libevdev);
+    close(fd);
+    return 0;
+  }
+
+  *device = (struct evdev_device){
+      .libevdev = libevdev,
+      .fd = fd,
+      .kind = kind,
+  };
+
+  u32 stickAxes[2] = {ABS_X, ABS_Y};
+  for (u32 index = 0; index < 2; index++) {
+    const struct input_absinfo *absinfo =
+        libevdev_get_abs_info(libevdev, stickAxes[index]);
+    if (!absinfo)
+      continue;
+    device->stickMin[index] = absinfo->minimum;
+    device->stickMax[index] = absinfo->maximum;
+  }
+
+  return 1;
+}
+
+static void EvdevDeviceClose(struct evdev_device *device) {
+  if (device->libevdev)
+    libevdev_free(device->libevdev);
+  if (device->fd != -1)
+    close(device->fd);
+  *device = (struct evdev_device){.fd = -1};
+}
+
+/*
+ * @return axis value mapped to [-1, 1]
+ */
+static inline f32 EvdevStickValue(struct evdev_device *device, u32 axisIndex,
+                                  s32 value) {
+  s32 min = device->stickMin[axisIndex];
+  s32 max = device->stickMax[axisIndex];
+  if (max <= min)
+    return 0;
+  return ((f32)(value - min) / (f32)(max - min)) * 2.0f - 1.0f;
+}
+
+static void EvdevDeviceApply(struct evdev_device *device, struct input *input,
+                             struct input_event *event) {
+  b8 isPressed = event->value != 0;
+  switch (event->type) {
+  case EV_KEY: {
+    // key repeat, state did not change
+    if (event->value == 2)
+      break;
+
+    switch (event->code) {
+    case BTN_DPAD_UP:
+    case KEY_W:
+    case KEY_UP: {
+      ButtonSet(&input->up, isPressed);
+    } break;
+    case BTN_DPAD_DOWN:
+    case KEY_S:
+    case KEY_DOWN: {
+      ButtonSet(&input->down, isPressed);
+    } break;
+    case BTN_DPAD_LEFT:
+    case KEY_A:
+    case KEY_LEFT: {
+      ButtonSet(&input->left, isPressed);
+    } break;
+    case BTN_DPAD_RIGHT:
+    case KEY_D:
+    case KEY_RIGHT: {
+      ButtonSet(&input->right, isPressed);
+    } break;
+    }
+  } break;
+
+  case EV_ABS: {
+    switch (event->code) {
+    // most gamepads report d-pad as hat
+    case ABS_HAT0X: {
+      ButtonSet(&input->left, event->value < 0);
+      ButtonSet(&input->right, event->value > 0);
+    } break;
+    case ABS_HAT0Y: {
+      ButtonSet(&input->up, event->value < 0);
+      ButtonSet(&input->down, event->value > 0);
+    } break;
+    case ABS_X: {
+      input->stickX = EvdevStickValue(device, 0, event->value);
+    } break;
+    case ABS_Y: {
+      input->stickY = EvdevStickValue(device, 1, event->value);
+    } break;
+    }
+  } break;
+  }
+}
+
+/*
+ * Drains every pending event into input.
+ * When kernel buffer overflowed, libevdev replays state changes that were
+ * lost, so buttons are never stuck.
+ *
+ * @return 0 when device is gone
+ */
+static b8 EvdevDeviceRead(struct evdev_device *device, struct input *input) {
+  u32 flags = LIBEVDEV_READ_FLAG_NORMAL;
+  while (1) {
+    struct input_event event;
+    s32 status = libevdev_next_event(device->libevdev, flags, &event);
+    if (status == LIBEVDEV_READ_STATUS_SUCCESS ||
+        status == LIBEVDEV_READ_STATUS_SYNC) {
+      // sync status means SYN_DROPPED was seen, replay until -EAGAIN
+      if (status == LIBEVDEV_READ_STATUS_SYNC)
+        flags = LIBEVDEV_READ_FLAG_SYNC;
+      EvdevDeviceApply(device, input, &event);
+      continue;
+    }
+
+    if (status == -EAGAIN && flags == LIBEVDEV_READ_FLAG_SYNC) {
+      // - replay is done, read rest normally
+      flags = LIBEVDEV_READ_FLAG_NORMAL;
+      continue;
+    }
+
+    return status == -EAGAIN;
+  }
+}
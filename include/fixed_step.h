@@ -0,0 +1,77 @@
+#pragma once
+
+#include "assert.h"
+#include "type.h"
+
+/*
+ * Runs simulation at fixed rate, independent of how often frames are drawn.
+ *
+ * Elapsed time is accumulated and spent in whole steps. What is left is
+ * less than one step, renderer blends previous and current state by it.
+ * After a stall at most stepMax steps run, rest is dropped, so one frame
+ * never simulates more than stepMax steps.
+ *
+ * @code
+ *   FixedStepInit(fixedStep, 60, 8);
+ *   ..
+ *   // on every frame
+ *   u32 stepCount = FixedStepAdvance(fixedStep, elapsed);
+ *   for (u32 index = 0; index < stepCount; index++) {
+ *     previous = current;
+ *     update(&current, FixedStepSeconds(fixedStep));
+ *   }
+ *   draw(lerp(previous, current, FixedStepAlpha(fixedStep)));
+ * @endcode
+ */
+
+struct fixed_step {
+  // nanoseconds per step
+  u64 step;
+  // steps run at most in one advance
+  u32 stepMax;
+  // time not simulated yet, always less than step after advance
+  u64 accumulator;
+  // time thrown away because of stepMax
+  u64 droppedTime;
+};
+
+/*
+ * @param rate steps per second
+ */
+static void FixedStepInit(struct fixed_step *fixedStep, u32 rate,
+                          u32 stepMax) {
+  debug_assert(rate != 0 && stepMax != 0);
+  *fixedStep = (struct fixed_step){
+      .step = 1000000000 /* 1e9 */ / rate,
+      .stepMax = stepMax,
+  };
+}
+
+/*
+ * @param elapsed nanoseconds since previous advance
+ * @return steps to simulate now
+ */
+static inline u32 FixedStepAdvance(struct fixed_step *fixedStep, u64 elapsed) {
+  fixedStep->accumulator += elapsed;
+  u64 stepCount = fixedStep->accumulator / fixedStep->step;
+  if (stepCount > fixedStep->stepMax) {
+    // - drop what cannot be caught up, keep fraction for interpolation
+    u64 dropped = (stepCount - fixedStep->stepMax) * fixedStep->step;
+    fixedStep->accumulator -= dropped;
+    fixedStep->droppedTime += dropped;
+    stepCount = fixedStep->stepMax;
+  }
+  fixedStep->accumulator -= stepCount * fixedStep->step;
+  return (u32)stepCount;
+}
+
+static inline f32 FixedStepSeconds(struct fixed_step *fixedStep) {
+  return (f32)fixedStep->step / 1e9f;
+}
+
+/*
+ * @return how far time is between previous and current state, in [0, 1)
+ */
+static inline f32 FixedStepAlpha(struct fixed_step *fixedStep) {
+  return (f32)fixedStep->accumulator / (f32)fixedStep->step;
+}
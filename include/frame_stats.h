@@ -0,0 +1,136 @@
+#pragma once
+
+#include <string.h>
+
+#include "assert.h"
+#include "math.h"
+#include "memory.h"
+#include "type.h"
+
+/*
+ * Keeps durations of last frames and reports their percentiles.
+ *
+ * Recording is one store, so it can stay on in every build. Sorting is done
+ * only when report is asked for.
+ *
+ * @code
+ *   FrameStatsInit(stats, arena, 4096);
+ *   ..
+ *   // on every frame
+ *   FrameStatsRecord(stats, duration);
+ *   ..
+ *   struct frame_stats_report report = FrameStatsReport(stats, arena);
+ * @endcode
+ */
+
+struct frame_stats {
+  // ring of last durations, in nanoseconds
+  u64 *samples;
+  // must be power of 2
+  u32 capacity;
+  // frames recorded since init, only last capacity ones are kept
+  u64 count;
+  // frames not drawn because previous one was still in flight
+  u64 skippedCount;
+};
+
+struct frame_stats_report {
+  // frames that percentiles are computed from
+  u64 count;
+  u64 p50;
+  u64 p99;
+  u64 max;
+};
+
+/*
+ * @return 0 when samples do not fit into arena
+ */
+static b8 FrameStatsInit(struct frame_stats *stats, struct memory_arena *arena,
+                         u32 capacity) {
+  debug_assert(IsPowerOfTwo(capacity));
+  *stats = (struct frame_stats){
+      .samples = MemoryArenaPush(arena, sizeof(*stats->samples) * capacity,
+                                 sizeof(*stats->samples)),
+      .capacity = capacity,
+  };
+  return stats->samples != 0;
+}
+
+static inline void FrameStatsRecord(struct frame_stats *stats, u64 duration) {
+  stats->samples[stats->count & (stats->capacity - 1)] = duration;
+  stats->count++;
+}
+
+/*
+ * Sorts values in place, least significant byte first.
+ * @param temp must hold count values
+ */
+static void FrameStatsSort(u64 *values, u64 *temp, u64 count) {
+  u64 *source = values;
+  u64 *destination = temp;
+  for (u32 shift = 0; shift < 64; shift += 8) {
+    u64 offsets[256] = {};
+    for (u64 index = 0; index < count; index++)
+      offsets[(source[index] >> shift) & 0xff]++;
+
+    // every value has same byte, nothing moves
+    if (offsets[(source[0] >> shift) & 0xff] == count)
+      continue;
+
+    u64 offset = 0;
+    for (u32 digit = 0; digit < 256; digit++) {
+      u64 digitCount = offsets[digit];
+      offsets[digit] = offset;
+      offset += digitCount;
+    }
+
+    for (u64 index = 0; index < count; index++) {
+      u64 value = source[index];
+      destination[offsets[(value >> shift) & 0xff]++] = value;
+    }
+
+    u64 *swap = source;
+    source = destination;
+    destination = swap;
+  }
+
+  if (source != values)
+    memcpy(values, source, sizeof(*values) * count);
+}
+
+/*
+ * Nearest rank percentile of sorted values.
+ */
+static inline u64 FrameStatsPercentile(u64 *sorted, u64 count, u32 percent) {
+  debug_assert(count != 0 && percent <= 100);
+  u64 rank = (count * percent + 99) / 100;
+  return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+/*
+ * @param arena used for sorting, released before return
+ */
+static struct frame_stats_report FrameStatsReport(struct frame_stats *stats,
+                                                  struct memory_arena *arena) {
+  struct frame_stats_report report = {};
+  u64 count = stats->count < stats->capacity ? stats->count : stats->capacity;
+  if (count == 0)
+    return report;
+
+  struct memory_temp temp = MemoryTempBegin(arena);
+  u64 *sorted = MemoryArenaPush(arena, sizeof(*sorted) * count, sizeof(u64));
+  u64 *scratch = MemoryArenaPush(arena, sizeof(*sorted) * count, sizeof(u64));
+  if (sorted && scratch) {
+    memcpy(sorted, stats->samples, sizeof(*sorted) * count);
+    FrameStatsSort(sorted, scratch, count);
+    report = (struct frame_stats_report){
+        .count = count,
+        .p50 = FrameStatsPercentile(sorted, count, 50),
+        .p99 = FrameStatsPercentile(sorted, count, 99),
+        .max = sorted[count - 1],
+    };
+  }
+  MemoryTempEnd(&temp);
+
+  return report;
+}
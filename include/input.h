@@ -0,0 +1,207 @@
+#pragma once
+
+#include "assert.h"
+#include "math.h"
+#include "memory.h"
+#include "type.h"
+
+struct button {
+  b8 isPressed : 1;
+  // state changes since last update, tap shorter than a frame makes 2
+  u8 transitionCount;
+};
+
+/*
+ * State of one device, or of keyboard and mouse together.
+ */
+struct input {
+  struct button up;
+  struct button down;
+  struct button left;
+  struct button right;
+
+  // in surface coordinates
+  f32 pointerX;
+  f32 pointerY;
+  // moved since last update, unaccelerated, also reported while locked
+  f32 pointerDeltaX;
+  f32 pointerDeltaY;
+  struct button pointerLeft;
+  struct button pointerRight;
+  struct button pointerMiddle;
+  // scrolled since last update
+  f32 scrollX;
+  f32 scrollY;
+
+  // gamepad left stick, in [-1, 1], y grows down
+  f32 stickX;
+  f32 stickY;
+};
+
+enum action {
+  ACTION_UP = 1 << 0,
+  ACTION_DOWN = 1 << 1,
+  ACTION_LEFT = 1 << 2,
+  ACTION_RIGHT = 1 << 3,
+};
+
+static inline void ButtonSet(struct button *button, b8 isPressed) {
+  if (button->isPressed == isPressed)
+    return;
+  button->isPressed = isPressed ? 1 : 0;
+  button->transitionCount++;
+}
+
+static inline void InputSetActions(struct input *input, u32 actions,
+                                   b8 isPressed) {
+  if (actions & ACTION_UP)
+    ButtonSet(&input->up, isPressed);
+  if (actions & ACTION_DOWN)
+    ButtonSet(&input->down, isPressed);
+  if (actions & ACTION_LEFT)
+    ButtonSet(&input->left, isPressed);
+  if (actions & ACTION_RIGHT)
+    ButtonSet(&input->right, isPressed);
+}
+
+/*
+ * Clears what is counted per update, call after update has seen input.
+ * Devices that write into input between updates are not lost this way.
+ */
+static inline void InputEndFrame(struct input *input) {
+  input->up.transitionCount = 0;
+  input->down.transitionCount = 0;
+  input->left.transitionCount = 0;
+  input->right.transitionCount = 0;
+  input->pointerLeft.transitionCount = 0;
+  input->pointerRight.transitionCount = 0;
+  input->pointerMiddle.transitionCount = 0;
+  input->pointerDeltaX = 0;
+  input->pointerDeltaY = 0;
+  input->scrollX = 0;
+  input->scrollY = 0;
+}
+
+/*
+ * Input events in order they happened.
+ *
+ * Wayland dispatch pushes, update step pops. Every press and release is kept
+ * with its time, so a tap shorter than a frame is still seen by simulation.
+ * Queue is single producer, single consumer and lock free, so consumer can
+ * live on another thread.
+ *
+ * @code
+ *   // on wayland event
+ *   InputQueuePush(queue, &event);
+ *   ..
+ *   // on update
+ *   struct input_queue_event event;
+ *   while (InputQueuePop(queue, &event))
+ *     apply event
+ * @endcode
+ */
+
+enum input_event_type {
+  INPUT_EVENT_KEY,
+  INPUT_EVENT_POINTER_MOTION,
+  INPUT_EVENT_POINTER_BUTTON,
+  INPUT_EVENT_POINTER_AXIS,
+};
+
+struct input_queue_event {
+  // milliseconds with undefined base, from compositor
+  u32 time;
+  u8 type;
+  b8 isPressed;
+  // key: generated by held key, after press
+  b8 isRepeat;
+  // key: xkb keycode, button: linux button code
+  u32 code;
+  // key: bitmask of actions bound to key when it was pressed
+  u32 actions;
+  // motion: surface position, axis: scroll amount
+  f32 x;
+  f32 y;
+  // motion: unaccelerated movement since previous motion
+  f32 deltaX;
+  f32 deltaY;
+};
+
+#define INPUT_QUEUE_CACHE_LINE_SIZE 64
+
+struct input_queue {
+  struct input_queue_event *events;
+  // must be power of 2
+  u32 capacity;
+
+  // producer only writes writeIndex, consumer only writes readIndex.
+  // indices never wrap to capacity, they are masked on access
+  __attribute__((aligned(INPUT_QUEUE_CACHE_LINE_SIZE))) u32 writeIndex;
+  // events lost because consumer fell behind, producer only
+  u32 droppedCount;
+  __attribute__((aligned(INPUT_QUEUE_CACHE_LINE_SIZE))) u32 readIndex;
+  // droppedCount already reported, consumer only
+  u32 droppedCountTaken;
+};
+
+/*
+ * @return 0 when events do not fit into arena
+ */
+static b8 InputQueueInit(struct input_queue *queue, struct memory_arena *arena,
+                         u32 capacity) {
+  debug_assert(IsPowerOfTwo(capacity));
+  *queue = (struct input_queue){
+      .events = MemoryArenaPush(arena, sizeof(*queue->events) * capacity,
+                                INPUT_QUEUE_CACHE_LINE_SIZE),
+      .capacity = capacity,
+  };
+  return queue->events != 0;
+}
+
+/*
+ * Called by producer.
+ * @return 0 when queue is full and event is dropped
+ */
+static inline b8 InputQueuePush(struct input_queue *queue,
+                                struct input_queue_event *event) {
+  u32 writeIndex = __atomic_load_n(&queue->writeIndex, __ATOMIC_RELAXED);
+  u32 readIndex = __atomic_load_n(&queue->readIndex, __ATOMIC_ACQUIRE);
+  if (writeIndex - readIndex == queue->capacity) {
+    __atomic_store_n(&queue->droppedCount, queue->droppedCount + 1,
+                     __ATOMIC_RELAXED);
+    return 0;
+  }
+
+  queue->events[writeIndex & (queue->capacity - 1)] = *event;
+  // event must be visible before index
+  __atomic_store_n(&queue->writeIndex, writeIndex + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+/*
+ * Called by consumer.
+ * @return 0 when queue is empty
+ */
+static inline b8 InputQueuePop(struct input_queue *queue,
+                               struct input_queue_event *event) {
+  u32 readIndex = __atomic_load_n(&queue->readIndex, __ATOMIC_RELAXED);
+  u32 writeIndex = __atomic_load_n(&queue->writeIndex, __ATOMIC_ACQUIRE);
+  if (readIndex == writeIndex)
+    return 0;
+
+  *event = queue->events[readIndex & (queue->capacity - 1)];
+  // slot must be read before producer can reuse it
+  __atomic_store_n(&queue->readIndex, readIndex + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+/*
+ * Called by consumer.
+ * @return events dropped since previous call
+ */
+static inline u32 InputQueueTakeDropped(struct input_queue *queue) {
+  u32 droppedCount = __atomic_load_n(&queue->droppedCount, __ATOMIC_RELAXED);
+  u32 result = droppedCount - queue->droppedCountTaken;
+  queue->droppedCountTaken = droppedCount;
+  return result;
+}
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <pthread.h>
+
+#include "assert.h"
+#include "memory.h"
+#include "type.h"
+
+/*
+ * Job system with one work-stealing deque per thread.
+ *
+ * Thread that calls JobQueueInit() becomes worker 0. It is expected to push
+ * jobs and either go back to its own work or help with JobCounterWait().
+ * Other workers pop from their own deque (LIFO) and when it is empty steal
+ * from others (FIFO).
+ *
+ * @code
+ *   struct job_counter counter = {};
+ *   JobCounterAdd(&counter, jobCount);
+ *   for (..) JobQueuePush(queue, job);
+ *   JobQueueWake(queue);
+ *   JobCounterWait(queue, &counter);
+ * @endcode
+ */
+
+struct job;
+struct job_counter;
+
+typedef void (*job_fn)(struct job *job);
+typedef void (*job_counter_complete_fn)(struct job_counter *counter);
+
+struct job_counter {
+  u32 pending;
+  // called by thread that finished last job, may be 0
+  job_counter_complete_fn onComplete;
+};
+
+/*
+ * Embed this into your job data, and cast back in work function.
+ */
+struct job {
+  job_fn work;
+  struct job_counter *counter;
+};
+
+// must be power of 2
+#define JOB_DEQUE_CAPACITY 1024
+#define JOB_CACHE_LINE_SIZE 64
+
+/*
+ * Chase-Lev deque.
+ * see: Lê et al. Correct and Efficient Work-Stealing for Weak Memory Models
+ */
+struct job_deque {
+  // thieves take from top
+  __attribute__((aligned(JOB_CACHE_LINE_SIZE))) s64 top;
+  // owner pushes and pops from bottom
+  __attribute__((aligned(JOB_CACHE_LINE_SIZE))) s64 bottom;
+  __attribute__((aligned(JOB_CACHE_LINE_SIZE))) struct job
+      *jobs[JOB_DEQUE_CAPACITY];
+};
+
+struct job_queue;
+struct job_worker {
+  struct job_deque deque;
+  struct job_queue *queue;
+  pthread_t thread;
+  u32 index;
+};
+
+struct job_queue {
+  struct job_worker *workers;
+  // including thread that called JobQueueInit()
+  u32 workerCount;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  u32 wakeGeneration;
+  b8 isQuitting;
+};
+
+static __thread u32 JobWorkerIndex;
+
+/*
+ * Only owner can call.
+ * @return 0 when deque is full
+ */
+static inline b8 JobDequePush(struct job_deque *deque, struct job *job) {
+  s64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+  s64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+  if (bottom - top >= JOB_DEQUE_CAPACITY)
+    return 0;
+
+  __atomic_store_n(&deque->jobs[bottom & (JOB_DEQUE_CAPACITY - 1)], job,
+                   __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+  return 1;
+}
+
+/*
+ * Only owner can call.
+ * @return 0 when deque is empty
+ */
+static inline struct job *JobDequePop(struct job_deque *deque) {
+  s64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+  __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  s64 top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+  struct job *job = 0;
+  if (top <= bottom) {
+    job = __atomic_load_n(&deque->jobs[bottom & (JOB_DEQUE_CAPACITY - 1)],
+                          __ATOMIC_RELAXED);
+    if (top == bottom) {
+      // last item, race against thieves
+      if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        job = 0;
+      __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+  } else {
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+  }
+
+  return job;
+}
+
+/*
+ * Any thread can call.
+ * @return 0 when deque is empty or lost race
+ */
+static inline struct job *JobDequeSteal(struct job_deque *deque) {
+  s64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  s64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+  if (top >= bottom)
+    return 0;
+
+  struct job *job = __atomic_load_n(
+      &deque->jobs[top & (JOB_DEQUE_CAPACITY - 1)], __ATOMIC_RELAXED);
+  if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0,
+                                   __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    return 0;
+
+  return job;
+}
+
+static inline void JobCounterAdd(struct job_counter *counter, u32 count) {
+  __atomic_add_fetch(&counter->pending, count, __ATOMIC_RELAXED);
+}
+
+static inline b8 IsJobCounterDone(struct job_counter *counter) {
+  return __atomic_load_n(&counter->pending, __ATOMIC_ACQUIRE) == 0;
+}
+
+static inline void JobRun(struct job *job) {
+  struct job_counter *counter = job->counter;
+  job->work(job);
+
+  if (counter &&
+      __atomic_sub_fetch(&counter->pending, 1, __ATOMIC_ACQ_REL) == 0 &&
+      counter->onComplete)
+    counter->onComplete(counter);
+}
+
+/*
+ * Finds work for worker, first from its own deque then from others.
+ */
+static inline struct job *JobQueueFind(struct job_queue *queue,
+                                       struct job_worker *worker) {
+  struct job *job = JobDequePop(&worker->deque);
+  if (job)
+    return job;
+
+  for (u32 offset = 1; offset < queue->workerCount; offset++) {
+    u32 victimIndex = (worker->index + offset) % queue->workerCount;
+    job = JobDequeSteal(&queue->workers[victimIndex].deque);
+    if (job)
+      return job;
+  }
+
+  return 0;
+}
+
+/*
+ * Pushes job into calling thread's deque.
+ * Runs job immediately when there is nobody to take it.
+ * Call JobQueueWake() after pushing a batch.
+ */
+static inline void JobQueuePush(struct job_queue *queue, struct job *job) {
+  struct job_worker *worker = queue->workers + JobWorkerIndex;
+  if (queue->workerCount == 1 || !JobDequePush(&worker->deque, job))
+    JobRun(job);
+}
+
+static inline void JobQueueWake(struct job_queue *queue) {
+  pthread_mutex_lock(&queue->mutex);
+  __atomic_add_fetch(&queue->wakeGeneration, 1, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&queue->cond);
+  pthread_mutex_unlock(&queue->mutex);
+}
+
+/*
+ * Helps running jobs until counter reaches zero.
+ */
+static inline void JobCounterWait(struct job_queue *queue,
+                                  struct job_counter *counter) {
+  struct job_worker *worker = queue->workers + JobWorkerIndex;
+  while (!IsJobCounterDone(counter)) {
+    struct job *job = JobQueueFind(queue, worker);
+    if (job)
+      JobRun(job);
+    else
+      __builtin_ia32_pause();
+  }
+}
+
+static void *JobWorkerMain(void *data) {
+  struct job_worker *worker = data;
+  struct job_queue *queue = worker->queue;
+  JobWorkerIndex = worker->index;
+
+  while (1) {
+    u32 generation = __atomic_load_n(&queue->wakeGeneration, __ATOMIC_ACQUIRE);
+
+    struct job *job = JobQueueFind(queue, worker);
+    if (job) {
+      JobRun(job);
+      continue;
+    }
+
+    // - sleep until new jobs are pushed
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->wakeGeneration == generation && !queue->isQuitting)
+      pthread_cond_wait(&queue->cond, &queue->mutex);
+    b8 isQuitting = queue->isQuitting;
+    pthread_mutex_unlock(&queue->mutex);
+
+    if (isQuitting)
+      break;
+  }
+
+  MemoryScratchRelease();
+  return 0;
+}
+
+/*
+ * @param workerCount total threads including caller, must be at least 1
+ * @return 0 when threads cannot be created or workers do not fit into arena
+ */
+static b8 JobQueueInit(struct job_queue *queue, struct memory_arena *arena,
+                       u32 workerCount) {
+  debug_assert(workerCount >= 1);
+
+  *queue = (struct job_queue){
+      .workers = MemoryArenaPush(arena, sizeof(*queue->workers) * workerCount,
+                                 JOB_CACHE_LINE_SIZE),
+      .workerCount = workerCount,
+  };
+  if (!queue->workers)
+    return 0;
+  pthread_mutex_init(&queue->mutex, 0);
+  pthread_cond_init(&queue->cond, 0);
+
+  JobWorkerIndex = 0;
+  for (u32 index = 0; index < workerCount; index++) {
+    struct job_worker *worker = queue->workers + index;
+    *worker = (struct job_worker){
+        .queue = queue,
+        .index = index,
+    };
+  }
+
+  for (u32 index = 1; index < workerCount; index++) {
+    struct job_worker *worker = queue->workers + index;
+    if (pthread_create(&worker->thread, 0, JobWorkerMain, worker)) {
+      // - stop already created ones
+      pthread_mutex_lock(&queue->mutex);
+      queue->isQuitting = 1;
+      pthread_cond_broadcast(&queue->cond);
+      pthread_mutex_unlock(&queue->mutex);
+
+      for (u32 createdIndex = 1; createdIndex < index; createdIndex++)
+        pthread_join(queue->workers[createdIndex].thread, 0);
+      return 0;
+    }
+    pthread_setname_np(worker->thread, "worker");
+  }
+
+  return 1;
+}
+
+static void JobQueueDestroy(struct job_queue *queue) {
+  pthread_mutex_lock(&queue->mutex);
+  queue->isQuitting = 1;
+  pthread_cond_broadcast(&queue->cond);
+  pthread_mutex_unlock(&queue->mutex);
+
+  for (u32 index = 1; index < queue->workerCount; index++)
+    pthread_join(queue->workers[index].thread, 0);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <errno.h>
+
+#include "memory.h"
+#include "text.h"
+#include "type.h"
+
+/*
+ * Double buffered log.
+ *
+ * Messages are copied into fill buffer, which never blocks. Owner takes
+ * whole fill buffer with LogSwap() and writes it asynchronously, while new
+ * messages go into other buffer. When fill buffer runs out of space while
+ * write is still in flight, messages are dropped and counted.
+ *
+ * @code
+ *   LogAppend(log, &message);
+ *   ..
+ *   struct string pending = LogSwap(log);
+ *   if (pending.length) submit write of pending
+ *   ..
+ *   // on write completion
+ *   pending = LogWriteDone(log, written);
+ *   if (pending.length) submit write of pending
+ * @endcode
+ */
+
+struct log {
+  u8 *buffers[2];
+  u64 lengths[2];
+  // size of each buffer
+  u64 capacity;
+  // messages go into buffers[fillIndex]
+  u32 fillIndex;
+  // bytes of buffers[fillIndex ^ 1] already written
+  u64 writtenLength;
+  b8 isWriting : 1;
+  // bytes lost since last swap, reported in next batch
+  u64 droppedLength;
+};
+
+/*
+ * @return 0 when buffers do not fit into arena
+ */
+static b8 LogInit(struct log *log, struct memory_arena *arena, u64 capacity) {
+  *log = (struct log){
+      .buffers =
+          {
+              MemoryArenaPush(arena, capacity, 64),
+              MemoryArenaPush(arena, capacity, 64),
+          },
+      .capacity = capacity,
+  };
+  return log->buffers[0] && log->buffers[1];
+}
+
+/*
+ * @return 0 when message is dropped
+ */
+static inline b8 LogAppend(struct log *log, struct string *message) {
+  u64 *length = log->lengths + log->fillIndex;
+  if (*length + message->length > log->capacity) {
+    log->droppedLength += message->length;
+    return 0;
+  }
+
+  memcpy(log->buffers[log->fillIndex] + *length, message->value,
+         message->length);
+  *length += message->length;
+  return 1;
+}
+
+/*
+ * Hands over fill buffer for writing.
+ * @return empty string when write is in flight or there is nothing to write
+ */
+static inline struct string LogSwap(struct log *log) {
+  u32 writeIndex = log->fillIndex;
+  if (log->isWriting || log->lengths[writeIndex] == 0)
+    return (struct string){};
+
+  log->isWriting = 1;
+  log->writtenLength = 0;
+  log->fillIndex = writeIndex ^ 1;
+  log->lengths[log->fillIndex] = 0;
+
+  // - tell reader that messages are lost
+  if (log->droppedLength != 0) {
+    u8 digits[20];
+    struct string digitsBuffer = {.value = digits, .length = sizeof(digits)};
+    struct string droppedLength = FormatU64(&digitsBuffer, log->droppedLength);
+    log->droppedLength = 0;
+    LogAppend(log, &STRING_FROM_ZERO_TERMINATED("log: dropped "));
+    LogAppend(log, &droppedLength);
+    LogAppend(log, &STRING_FROM_ZERO_TERMINATED(" bytes\n"));
+  }
+
+  return (struct string){.value = log->buffers[writeIndex],
+                         .length = log->lengths[writeIndex]};
+}
+
+/*
+ * Call when write of buffer returned by LogSwap() completes.
+ * @param written bytes written, or negative errno
+ * @return rest of buffer when write was short, otherwise empty string
+ */
+static inline struct string LogWriteDone(struct log *log, s64 written) {
+  debug_assert(log->isWriting);
+  u32 writeIndex = log->fillIndex ^ 1;
+  u64 length = log->lengths[writeIndex];
+
+  // on error give up on this batch, writer cannot do better
+  b8 isRetry = written == -EINTR || written == -EAGAIN;
+  if (written > 0)
+    log->writtenLength += (u64)written;
+  if ((written <= 0 && !isRetry) || log->writtenLength >= length) {
+    log->isWriting = 0;
+    return (struct string){};
+  }
+
+  return (struct string){.value = log->buffers[writeIndex] +
+                                  log->writtenLength,
+                         .length = length - log->writtenLength};
+}
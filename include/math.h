@@ -61,3 +61,20 @@ bsrl(u64 x)
   x |= x >> 32;
   return kDebruijn[(x * 0x03f79d71b4cb0a89ull) >> 58];
 }
+
+/*
+ * Returns index of lowest set bit of 𝑥, same as count of trailing zero bits.
+ * Compiles to single tzcnt when BMI is available, bsf otherwise.
+ *
+ *   0b0001 → 0
+ *   0b1010 → 1
+ *   1 << 63 → 63
+ *
+ * @param x is a 64-bit integer, must not be 0
+ * @return number in range 0..63, undefined if 𝑥 is 0
+ */
+static inline u8
+bsfl(u64 x)
+{
+  return (u8)__builtin_ctzll(x);
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include "assert.h"
 #include "math.h"
 #include "type.h"
@@ -22,12 +25,149 @@
 #error memcpy must be supported by compiler
 #endif
 
+enum memory_arena_flag {
+  // only address space is reserved, pages are committed as arena grows
+  MEMORY_ARENA_GROWABLE = 1 << 0,
+  // fault in committed pages immediately instead of on first touch
+  MEMORY_ARENA_POPULATE = 1 << 1,
+  // ask for transparent huge pages, commits in huge page steps
+  MEMORY_ARENA_HUGE_PAGE = 1 << 2,
+};
+
+#ifndef IS_MEMORY_STATS_ENABLED
+#define IS_MEMORY_STATS_ENABLED IS_BUILD_DEBUG
+#endif
+
+struct memory_arena_stats {
+  // highest used seen, arena can be shrunk down to this
+  u64 usedMax;
+  u64 pushCount;
+  // bytes skipped to align pushes
+  u64 alignmentWaste;
+  u32 tempDepth;
+  u32 tempDepthMax;
+};
+
 struct memory_arena {
   void *block;
   u64 used;
   u64 total;
+  // growable arenas only, bytes from block that are readable and writable
+  u64 committed;
+  // growable arenas only, part of committed that was given to sub arenas,
+  // they commit their own pages
+  u64 subCommitted;
+  u32 flags;
+#if IS_MEMORY_STATS_ENABLED
+  struct memory_arena_stats stats;
+#endif
 };
 
+#if IS_MEMORY_STATS_ENABLED
+static inline void MemoryArenaStatsRecordPush(struct memory_arena *arena,
+                                              u64 alignmentWaste) {
+  struct memory_arena_stats *stats = &arena->stats;
+  stats->pushCount++;
+  stats->alignmentWaste += alignmentWaste;
+  if (arena->used > stats->usedMax)
+    stats->usedMax = arena->used;
+}
+#else
+#define MemoryArenaStatsRecordPush(arena, alignmentWaste)                      \
+  (void)(alignmentWaste)
+#endif
+
+// growable arena commits at least this much at once
+#define MEMORY_ARENA_COMMIT_SIZE (64 * 1024)
+#define MEMORY_ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/*
+ * Reserves address space without using memory. Pages become usable as
+ * arena grows, so there is no hard ceiling other than size, and memory
+ * that is never pushed is never committed.
+ *
+ * @return 0 when address space cannot be reserved
+ */
+static b8 MemoryArenaReserve(struct memory_arena *arena, u64 size, u32 flags) {
+  if (flags & MEMORY_ARENA_HUGE_PAGE)
+    size = (size + MEMORY_ARENA_HUGE_PAGE_SIZE - 1) &
+           ~(u64)(MEMORY_ARENA_HUGE_PAGE_SIZE - 1);
+
+  void *block = mmap(0, size, PROT_NONE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (block == MAP_FAILED)
+    return 0;
+
+  if (flags & MEMORY_ARENA_HUGE_PAGE)
+    madvise(block, size, MADV_HUGEPAGE);
+
+  *arena = (struct memory_arena){
+      .block = block,
+      .total = size,
+      .flags = flags | MEMORY_ARENA_GROWABLE,
+  };
+  return 1;
+}
+
+/*
+ * Makes sure first size bytes of growable arena are usable.
+ * @return 0 when size is larger than arena or kernel refuses to give memory
+ */
+static b8 MemoryArenaCommit(struct memory_arena *arena, u64 size) {
+  debug_assert(arena->flags & MEMORY_ARENA_GROWABLE);
+  if (size <= arena->committed)
+    return 1;
+  if (size > arena->total)
+    return 0;
+
+  u64 commitSize = (arena->flags & MEMORY_ARENA_HUGE_PAGE)
+                       ? MEMORY_ARENA_HUGE_PAGE_SIZE
+                       : MEMORY_ARENA_COMMIT_SIZE;
+  u64 committed = (size + commitSize - 1) / commitSize * commitSize;
+  if (committed > arena->total)
+    committed = arena->total;
+
+  // sub arenas may not start at page boundary, neighbour page is already
+  // committed and mprotect keeps its content
+  u64 pagesize = (u64)sysconf(_SC_PAGESIZE);
+  u64 start = ((u64)arena->block + arena->committed) & ~(pagesize - 1);
+  u64 end = ((u64)arena->block + committed + pagesize - 1) & ~(pagesize - 1);
+  if (mprotect((void *)start, end - start, PROT_READ | PROT_WRITE) != 0)
+    return 0;
+
+#ifdef MADV_POPULATE_WRITE
+  if (arena->flags & MEMORY_ARENA_POPULATE)
+    madvise((void *)start, end - start, MADV_POPULATE_WRITE);
+#endif
+
+  arena->committed = committed;
+  return 1;
+}
+
+/*
+ * Gives pages after first size bytes of growable arena back to kernel,
+ * together with any mapping placed over them. They are committed again
+ * when arena grows.
+ */
+static void MemoryArenaDecommit(struct memory_arena *arena, u64 size) {
+  debug_assert(arena->flags & MEMORY_ARENA_GROWABLE);
+  if (size >= arena->committed)
+    return;
+
+  // pages shared with neighbour sub arenas are kept
+  u64 pagesize = (u64)sysconf(_SC_PAGESIZE);
+  u64 start = ((u64)arena->block + size + pagesize - 1) & ~(pagesize - 1);
+  u64 end = ((u64)arena->block + arena->committed) & ~(pagesize - 1);
+  if (start >= end)
+    return;
+
+  mmap((void *)start, end - start, PROT_NONE,
+       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+  if (arena->flags & MEMORY_ARENA_HUGE_PAGE)
+    madvise((void *)start, end - start, MADV_HUGEPAGE);
+  arena->committed = start - (u64)arena->block;
+}
+
 struct memory_chunk {
   void *block;
   u64 size;
@@ -39,6 +179,9 @@ struct memory_temp {
   u64 startedAt;
 };
 
+/*
+ * Sub arena of growable arena is growable too, it commits its own pages.
+ */
 static struct memory_arena MemoryArenaSub(struct memory_arena *master,
                                           u64 size) {
   debug_assert(master->used + size <= master->total);
@@ -46,19 +189,38 @@ static struct memory_arena MemoryArenaSub(struct memory_arena *master,
   struct memory_arena sub = {
       .total = size,
       .block = master->block + master->used,
+      .flags = master->flags,
   };
 
   master->used += size;
+  if ((master->flags & MEMORY_ARENA_GROWABLE) &&
+      master->committed < master->used) {
+    // - master must not commit pages of sub on its next push
+    master->subCommitted += master->used - master->committed;
+    master->committed = master->used;
+  }
+  MemoryArenaStatsRecordPush(master, 0);
   return sub;
 }
 
+/*
+ * @return 0 when it does not fit into arena
+ */
 static void *MemoryArenaPushUnaligned(struct memory_arena *mem, u64 size) {
-  debug_assert(mem->used + size <= mem->total);
+  if (size > mem->total - mem->used)
+    return 0;
+  if ((mem->flags & MEMORY_ARENA_GROWABLE) &&
+      !MemoryArenaCommit(mem, mem->used + size))
+    return 0;
   void *result = mem->block + mem->used;
   mem->used += size;
+  MemoryArenaStatsRecordPush(mem, 0);
   return result;
 }
 
+/*
+ * @return 0 when it does not fit into arena
+ */
 static void *MemoryArenaPush(struct memory_arena *mem, u64 size,
                              u64 alignment) {
   debug_assert(IsPowerOfTwo(alignment));
@@ -67,15 +229,21 @@ static void *MemoryArenaPush(struct memory_arena *mem, u64 size,
 
   u64 alignmentMask = alignment - 1;
   u64 alignmentResult = ((u64)block & alignmentMask);
+  u64 alignmentOffset = 0;
   if (alignmentResult != 0) {
     // if it is not aligned
-    u64 alignmentOffset = alignment - alignmentResult;
+    alignmentOffset = alignment - alignmentResult;
     size += alignmentOffset;
     block += alignmentOffset;
   }
 
-  debug_assert(mem->used + size <= mem->total);
+  if (size > mem->total - mem->used)
+    return 0;
+  if ((mem->flags & MEMORY_ARENA_GROWABLE) &&
+      !MemoryArenaCommit(mem, mem->used + size))
+    return 0;
   mem->used += size;
+  MemoryArenaStatsRecordPush(mem, alignmentOffset);
 
   return block;
 }
@@ -84,6 +252,8 @@ static struct memory_chunk *MemoryArenaPushChunk(struct memory_arena *mem,
                                                  u64 size, u64 max) {
   struct memory_chunk *chunk =
       MemoryArenaPush(mem, sizeof(*chunk) + max * sizeof(u8) + max * size, 4);
+  if (!chunk)
+    return 0;
   chunk->block = (u8 *)chunk + sizeof(*chunk);
   chunk->size = size;
   chunk->max = max;
@@ -132,7 +302,125 @@ static void MemoryChunkPop(struct memory_chunk *chunk, void *block) {
   *flag = 0;
 }
 
+/*
+ * Fixed size slot allocator, like memory_chunk but push and pop are O(1).
+ *
+ * Every slot has one bit in freeBits, set when slot is free. Every word of
+ * freeBits has one bit in freeWordBits, set when word has any free slot.
+ * Push finds free slot with two tzcnt.
+ *
+ * 1M slots need 16K freeBits words and 256 freeWordBits words.
+ */
+struct memory_pool {
+  void *block;
+  u64 *freeBits;
+  u64 *freeWordBits;
+  u64 size;
+  u64 max;
+  // every freeWordBits word before this is 0
+  u64 freeWordBitsHint;
+};
+
+#define MEMORY_POOL_WORD_BITS 64
+#define MEMORY_POOL_WORD_COUNT(bitCount)                                       \
+  (((bitCount) + MEMORY_POOL_WORD_BITS - 1) / MEMORY_POOL_WORD_BITS)
+
+/*
+ * @return 0 when pool does not fit
+ */
+static b8 MemoryArenaPushPool(struct memory_arena *mem,
+                              struct memory_pool *pool, u64 size, u64 max) {
+  u64 wordCount = MEMORY_POOL_WORD_COUNT(max);
+  u64 summaryCount = MEMORY_POOL_WORD_COUNT(wordCount);
+  *pool = (struct memory_pool){
+      .freeBits = MemoryArenaPush(mem, wordCount * sizeof(u64), sizeof(u64)),
+      .freeWordBits =
+          MemoryArenaPush(mem, summaryCount * sizeof(u64), sizeof(u64)),
+      .block = MemoryArenaPush(mem, max * size, sizeof(u64)),
+      .size = size,
+      .max = max,
+  };
+  if (!pool->freeBits || !pool->freeWordBits || !pool->block)
+    return 0;
+
+  // - mark every slot free, bits after max are never free
+  for (u64 wordIndex = 0; wordIndex < wordCount; wordIndex++) {
+    u64 slotCount = max - wordIndex * MEMORY_POOL_WORD_BITS;
+    pool->freeBits[wordIndex] = slotCount >= MEMORY_POOL_WORD_BITS
+                                    ? ~(u64)0
+                                    : ((u64)1 << slotCount) - 1;
+  }
+  for (u64 summaryIndex = 0; summaryIndex < summaryCount; summaryIndex++) {
+    u64 bitCount = wordCount - summaryIndex * MEMORY_POOL_WORD_BITS;
+    pool->freeWordBits[summaryIndex] = bitCount >= MEMORY_POOL_WORD_BITS
+                                           ? ~(u64)0
+                                           : ((u64)1 << bitCount) - 1;
+  }
+  return 1;
+}
+
+static inline b8 MemoryPoolIsDataAvailableAt(struct memory_pool *pool,
+                                             u64 index) {
+  u64 word = pool->freeBits[index / MEMORY_POOL_WORD_BITS];
+  return ((word >> (index % MEMORY_POOL_WORD_BITS)) & 1) == 0;
+}
+
+static inline void *MemoryPoolGetDataAt(struct memory_pool *pool, u64 index) {
+  return (u8 *)pool->block + index * pool->size;
+}
+
+/*
+ * @return lowest free slot, 0 when pool is full
+ */
+static inline void *MemoryPoolPush(struct memory_pool *pool) {
+  u64 summaryCount = MEMORY_POOL_WORD_COUNT(MEMORY_POOL_WORD_COUNT(pool->max));
+  for (u64 summaryIndex = pool->freeWordBitsHint; summaryIndex < summaryCount;
+       summaryIndex++) {
+    u64 summary = pool->freeWordBits[summaryIndex];
+    if (summary == 0)
+      continue;
+    pool->freeWordBitsHint = summaryIndex;
+
+    u64 wordIndex = summaryIndex * MEMORY_POOL_WORD_BITS + bsfl(summary);
+    u64 word = pool->freeBits[wordIndex];
+    u64 index = wordIndex * MEMORY_POOL_WORD_BITS + bsfl(word);
+
+    // - clear lowest set bit
+    word &= word - 1;
+    pool->freeBits[wordIndex] = word;
+    if (word == 0)
+      pool->freeWordBits[summaryIndex] = summary & (summary - 1);
+
+    return MemoryPoolGetDataAt(pool, index);
+  }
+
+  pool->freeWordBitsHint = summaryCount;
+  return 0;
+}
+
+static inline void MemoryPoolPop(struct memory_pool *pool, void *block) {
+  debug_assert((block >= pool->block &&
+                block < pool->block + (pool->size * pool->max)) &&
+               "this block is not belong to this pool");
+  u64 index = ((u64)block - (u64)pool->block) / pool->size;
+  debug_assert(MemoryPoolIsDataAvailableAt(pool, index) && "double pop");
+
+  u64 wordIndex = index / MEMORY_POOL_WORD_BITS;
+  u64 summaryIndex = wordIndex / MEMORY_POOL_WORD_BITS;
+  pool->freeBits[wordIndex] |= (u64)1 << (index % MEMORY_POOL_WORD_BITS);
+  pool->freeWordBits[summaryIndex] |= (u64)1
+                                      << (wordIndex % MEMORY_POOL_WORD_BITS);
+  if (summaryIndex < pool->freeWordBitsHint)
+    pool->freeWordBitsHint = summaryIndex;
+}
+
 static struct memory_temp MemoryTempBegin(struct memory_arena *arena) {
+#if IS_MEMORY_STATS_ENABLED
+  struct memory_arena_stats *stats = &arena->stats;
+  stats->tempDepth++;
+  if (stats->tempDepth > stats->tempDepthMax)
+    stats->tempDepthMax = stats->tempDepth;
+#endif
   return (struct memory_temp){
       .arena = arena,
       .startedAt = arena->used,
@@ -142,6 +430,68 @@ static struct memory_temp MemoryTempBegin(struct memory_arena *arena) {
 static void MemoryTempEnd(struct memory_temp *tempMemory) {
   struct memory_arena *arena = tempMemory->arena;
   arena->used = tempMemory->startedAt;
+#if IS_MEMORY_STATS_ENABLED
+  debug_assert(arena->stats.tempDepth != 0);
+  arena->stats.tempDepth--;
+#endif
+}
+
+// scratch arenas per thread
+#define MEMORY_SCRATCH_COUNT 2
+// address space of each scratch arena, pages are committed on demand
+#define MEMORY_SCRATCH_SIZE (256 * 1024 * 1024)
+
+static __thread struct memory_arena MemoryScratchArenas[MEMORY_SCRATCH_COUNT];
+
+/*
+ * Temp memory for transient data on calling thread's own arena, so no lock
+ * is needed. Arenas are reserved on first use.
+ *
+ * Function that pushes its result into arena given by caller must pass that
+ * arena as conflict. Otherwise when caller's arena is itself scratch, its
+ * result would be released together with function's temporary data.
+ *
+ * @param conflict arena that must not be returned, can be 0
+ */
+static struct memory_temp MemoryScratchBegin(struct memory_arena *conflict) {
+  struct memory_arena *arena = MemoryScratchArenas;
+  if (arena == conflict)
+    arena++;
+
+  if (!arena->block) {
+    b8 isReserved = MemoryArenaReserve(arena, MEMORY_SCRATCH_SIZE, 0);
+    runtime_assert(isReserved);
+  }
+
+  return MemoryTempBegin(arena);
+}
+
+/*
+ * Declares scratch temp memory that ends when it goes out of scope.
+ *
+ * @code
+ *   struct string Format(struct memory_arena *arena, ..) {
+ *     MEMORY_SCRATCH_SCOPE(scratch, arena);
+ *     u8 *temp = MemoryArenaPush(scratch.arena, size, 4);
+ *     ..
+ *     return MemoryArenaPush(arena, ..);
+ *   }
+ * @endcode
+ */
+#define MEMORY_SCRATCH_SCOPE(name, conflict)                                   \
+  struct memory_temp name __attribute__((cleanup(MemoryTempEnd))) =           \
+      MemoryScratchBegin(conflict)
+
+/*
+ * Gives back scratch arenas of calling thread. Call before thread exits.
+ */
+static void MemoryScratchRelease(void) {
+  for (u32 index = 0; index < MEMORY_SCRATCH_COUNT; index++) {
+    struct memory_arena *arena = MemoryScratchArenas + index;
+    if (arena->block)
+      munmap(arena->block, arena->total);
+    *arena = (struct memory_arena){};
+  }
 }
 
 #include "text.h"
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "StringBuilder.h"
+#include "assert.h"
+#include "memory.h"
+#include "type.h"
+
+/*
+ * Frame profiler.
+ *
+ * Zones are recorded as begin and end events into ring buffer of calling
+ * thread. Rings are allocated once in ProfilerInit(), recording never
+ * allocates or locks. When ring is full oldest events are overwritten, so
+ * last N events of every thread are always available for export.
+ *
+ * @code
+ *   ProfilerInit(&profiler, arena, threadCount, eventCount);
+ *   PROFILER_ZONE_BEGIN("update");
+ *   ..
+ *   PROFILER_ZONE_END("update");
+ *   ProfilerExportChromeTrace(&profiler, stringBuilder, fd);
+ * @endcode
+ *
+ * Exported file can be opened with chrome://tracing or ui.perfetto.dev
+ */
+
+#ifndef IS_PROFILER_ENABLED
+#define IS_PROFILER_ENABLED IS_BUILD_DEBUG
+#endif
+
+enum profiler_event_type {
+  PROFILER_EVENT_BEGIN,
+  PROFILER_EVENT_END,
+};
+
+struct profiler_event {
+  u64 tick;
+  // only pointer is stored, must live until export (e.g. string literal)
+  const char *name;
+  enum profiler_event_type type;
+};
+
+struct profiler_ring {
+  struct profiler_event *events;
+  // must be power of 2
+  u32 capacity;
+  u32 threadIndex;
+  // total events written, ring index is writeIndex & (capacity - 1)
+  u64 writeIndex;
+};
+
+#define PROFILER_THREAD_MAX 64
+
+struct profiler {
+  struct profiler_ring rings[PROFILER_THREAD_MAX];
+  u32 ringCount;
+  // rings handed out to threads so far
+  u32 ringClaimed;
+
+  // used for converting ticks to nanoseconds
+  u64 tickAtStart;
+  u64 nsAtStart;
+};
+
+// threads claim their ring on first event
+static struct profiler *ProfilerGlobal;
+static __thread struct profiler_ring *ProfilerThreadRing;
+static __thread b8 IsProfilerThreadRingExhausted;
+
+static inline u64 ProfilerNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000 /* 1e9 */ + (u64)ts.tv_nsec;
+}
+
+static inline u64 ProfilerTick(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return ProfilerNs();
+#endif
+}
+
+/*
+ * @param threadCount  maximum number of threads that can record events
+ * @param eventCount   events kept per thread, must be power of 2
+ * @return 0 when rings do not fit into arena
+ */
+static b8 ProfilerInit(struct profiler *profiler, struct memory_arena *arena,
+                       u32 threadCount, u32 eventCount) {
+  debug_assert(threadCount <= PROFILER_THREAD_MAX);
+  debug_assert(IsPowerOfTwo(eventCount));
+
+  *profiler = (struct profiler){
+      .ringCount = threadCount,
+  };
+  for (u32 index = 0; index < threadCount; index++) {
+    struct profiler_ring *ring = profiler->rings + index;
+    ring->events =
+        MemoryArenaPush(arena, sizeof(*ring->events) * eventCount, 8);
+    if (!ring->events)
+      return 0;
+    ring->capacity = eventCount;
+    ring->threadIndex = index;
+  }
+
+  profiler->nsAtStart = ProfilerNs();
+  profiler->tickAtStart = ProfilerTick();
+  ProfilerGlobal = profiler;
+  return 1;
+}
+
+/*
+ * @return ring of calling thread, 0 when every ring is taken
+ */
+static inline struct profiler_ring *ProfilerGetThreadRing(void) {
+  struct profiler_ring *ring = ProfilerThreadRing;
+  if (ring)
+    return ring;
+
+  struct profiler *profiler = ProfilerGlobal;
+  if (!profiler || IsProfilerThreadRingExhausted)
+    return 0;
+
+  u32 index = __atomic_fetch_add(&profiler->ringClaimed, 1, __ATOMIC_RELAXED);
+  if (index >= profiler->ringCount) {
+    IsProfilerThreadRingExhausted = 1;
+    return 0;
+  }
+
+  ring = profiler->rings + index;
+  ProfilerThreadRing = ring;
+  return ring;
+}
+
+static inline void ProfilerRecord(enum profiler_event_type type,
+                                  const char *name) {
+  struct profiler_ring *ring = ProfilerGetThreadRing();
+  if (!ring)
+    return;
+
+  u64 writeIndex = ring->writeIndex;
+  ring->events[writeIndex & (ring->capacity - 1)] = (struct profiler_event){
+      .tick = ProfilerTick(),
+      .name = name,
+      .type = type,
+  };
+  __atomic_store_n(&ring->writeIndex, writeIndex + 1, __ATOMIC_RELEASE);
+}
+
+#if IS_PROFILER_ENABLED
+#define PROFILER_ZONE_BEGIN(name) ProfilerRecord(PROFILER_EVENT_BEGIN, name)
+#define PROFILER_ZONE_END(name) ProfilerRecord(PROFILER_EVENT_END, name)
+#else
+#define PROFILER_ZONE_BEGIN(name)
+#define PROFILER_ZONE_END(name)
+#endif
+
+static inline void ProfilerAppendCString(struct string_builder *stringBuilder,
+                                         const char *value) {
+  struct string string = StringFromZeroTerminated((u8 *)value, 256);
+  StringBuilderAppendString(stringBuilder, &string);
+}
+
+/*
+ * Writes events of every thread to fd as Chrome trace event format.
+ * Threads must not record events while exporting.
+ * see: https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+ */
+static void ProfilerExportChromeTrace(struct profiler *profiler,
+                                      struct string_builder *stringBuilder,
+                                      int fd) {
+  // - measure tick frequency over whole run
+  u64 nsElapsed = ProfilerNs() - profiler->nsAtStart;
+  u64 tickElapsed = ProfilerTick() - profiler->tickAtStart;
+  f64 nsPerTick = tickElapsed == 0 ? 1.0 : (f64)nsElapsed / (f64)tickElapsed;
+
+  // leave room for one event before flushing
+  u64 flushAt = stringBuilder->outBuffer->length - 256;
+  debug_assert(stringBuilder->outBuffer->length > 256);
+
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED("{\"traceEvents\":["));
+  b8 isFirst = 1;
+  u32 ringClaimed = __atomic_load_n(&profiler->ringClaimed, __ATOMIC_ACQUIRE);
+  if (ringClaimed > profiler->ringCount)
+    ringClaimed = profiler->ringCount;
+  for (u32 ringIndex = 0; ringIndex < ringClaimed; ringIndex++) {
+    struct profiler_ring *ring = profiler->rings + ringIndex;
+    u64 writeIndex = __atomic_load_n(&ring->writeIndex, __ATOMIC_ACQUIRE);
+    u64 readIndex =
+        writeIndex > ring->capacity ? writeIndex - ring->capacity : 0;
+
+    // zones that begun before oldest event are dropped
+    u32 depth = 0;
+    for (; readIndex < writeIndex; readIndex++) {
+      struct profiler_event *event =
+          ring->events + (readIndex & (ring->capacity - 1));
+      if (event->type == PROFILER_EVENT_END) {
+        if (depth == 0)
+          continue;
+        depth--;
+      } else {
+        depth++;
+      }
+
+      // timestamp in microseconds since ProfilerInit()
+      u64 ns = event->tick < profiler->tickAtStart
+                   ? 0
+                   : (u64)((f64)(event->tick - profiler->tickAtStart) *
+                           nsPerTick);
+
+      if (!isFirst)
+        StringBuilderAppendString(stringBuilder,
+                                  &STRING_FROM_ZERO_TERMINATED(","));
+      isFirst = 0;
+
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED("{\"name\":\""));
+      ProfilerAppendCString(stringBuilder, event->name);
+      StringBuilderAppendString(
+          stringBuilder, event->type == PROFILER_EVENT_BEGIN
+                             ? &STRING_FROM_ZERO_TERMINATED("\",\"ph\":\"B\"")
+                             : &STRING_FROM_ZERO_TERMINATED("\",\"ph\":\"E\""));
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED(",\"ts\":"));
+      StringBuilderAppendU64(stringBuilder, ns / 1000);
+      {
+        // 3 digit fraction
+        u64 fraction = ns % 1000;
+        u8 digits[4] = {'.', (u8)('0' + fraction / 100),
+                        (u8)('0' + fraction / 10 % 10),
+                        (u8)('0' + fraction % 10)};
+        struct string string = {.value = digits, .length = sizeof(digits)};
+        StringBuilderAppendString(stringBuilder, &string);
+      }
+      StringBuilderAppendString(
+          stringBuilder, &STRING_FROM_ZERO_TERMINATED(",\"pid\":1,\"tid\":"));
+      StringBuilderAppendU64(stringBuilder, ring->threadIndex);
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED("}"));
+
+      if (stringBuilder->length >= flushAt) {
+        struct string string = StringBuilderFlush(stringBuilder);
+        write(fd, string.value, string.length);
+      }
+    }
+  }
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED("]}\n"));
+
+  struct string string = StringBuilderFlush(stringBuilder);
+  write(fd, string.value, string.length);
+}
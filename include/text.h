@@ -88,6 +88,19 @@ static inline b8 IsStringStartsWith(struct string *string,
   return 1;
 }
 
+/*
+ * 64-bit FNV-1a hash of string.
+ * Not for untrusted input where collisions can be forced.
+ */
+static inline u64 StringHash(struct string *string) {
+  u64 hash = 0xcbf29ce484222325;
+  for (u64 index = 0; index < string->length; index++) {
+    hash ^= string->value[index];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
 struct duration {
   u64 ns;
 };
@@ -18,7 +18,9 @@ WaylandProtocolsSrc=''
 for protocol in 'stable/xdg-shell/xdg-shell.xml' \
                 'stable/viewporter/viewporter.xml' \
                 'stable/presentation-time/presentation-time.xml' \
-                'staging/content-type/content-type-v1.xml'
+                'staging/content-type/content-type-v1.xml' \
+                'unstable/relative-pointer/relative-pointer-unstable-v1.xml' \
+                'unstable/pointer-constraints/pointer-constraints-unstable-v1.xml'
 do
   protocolBasename=$(BasenameWithoutExtension "$protocol")
   protocolXml="$WaylandProtocolsDir/$protocol"
@@ -1,14 +1,26 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/input-event-codes.h>
+#include <libevdev/libevdev.h>
 #include <liburing.h>
 #include <poll.h>
 #include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <wayland-client.h>
 #include <xkbcommon/xkbcommon.h>
 
 #include "content-type-v1-client-protocol.h"
+#include "pointer-constraints-unstable-v1-client-protocol.h"
+#include "presentation-time-client-protocol.h"
+#include "relative-pointer-unstable-v1-client-protocol.h"
+#include "viewporter-client-protocol.h"
 #include "xdg-shell-client-protocol.h"
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(*(x)))
@@ -17,14 +29,24 @@
 #define globalvar static
 
 #include "StringBuilder.h"
+#include "asset.h"
 #include "assert.h"
+#include "draw.h"
+#include "evdev.h"
+#include "fixed_step.h"
+#include "frame_stats.h"
+#include "input.h"
+#include "job.h"
+#include "log.h"
 #include "memory.h"
+#include "profiler.h"
 #include "type.h"
 
 enum error_tag {
   ERROR_NONE,
   ERROR_MMAP,
-  ERROR_OUTPUT_PTHREAD_CREATE,
+  // was ERROR_OUTPUT_PTHREAD_CREATE, exit codes of others must not move
+  ERROR_JOB_QUEUE_INIT,
   ERROR_WL_DISPLAY_CONNECT,
   ERROR_WL_DISPLAY_GET_REGISTRY,
   ERROR_WL_REGISTRY_GLOBAL,
@@ -38,63 +60,365 @@ enum error_tag {
   ERROR_IO_URING_QUEUE_INIT,
   ERROR_IO_URING_WAIT_CQE,
   ERROR_XKB_CONTEXT_NEW,
+  ERROR_EVENTFD,
+  ERROR_OUT_OF_MEMORY,
 };
 
-struct framebuffer {
-  u16 width;
-  u16 height;
-  u16 stride;
+// SWAPCHAIN
+// render next frame while compositor reads previous ones
+#define SWAPCHAIN_BUFFER_COUNT 3
+
+struct swapchain_buffer {
+  struct wl_buffer *wl_buffer;
   u8 *data;
+  // frame that buffer content belongs to, 0 when never drawn
+  u64 frameIndex;
+  // owned by renderer or compositor, cleared on wl_buffer.release
+  b8 isAcquired : 1;
+};
+
+struct swapchain {
+  struct swapchain_buffer buffers[SWAPCHAIN_BUFFER_COUNT];
+  // page aligned size of one buffer
+  u64 bufferSize;
+  // arena before buffers were pushed, arena is 0 until first resize
+  struct memory_temp bufferMemory;
+  // ask for huge pages and fault buffers in before first draw
+  b8 isHugePage : 1;
+  // pool is on hugetlbfs, otherwise transparent huge pages are only advised
+  b8 isHugeTlb : 1;
 };
 
-internal void DrawSolid(struct framebuffer *framebuffer, u32 color) {
-  u16 width = framebuffer->width;
-  u16 height = framebuffer->height;
-  u16 stride = framebuffer->stride;
-  u8 *row = framebuffer->data;
+internal void wl_buffer_release(void *data, struct wl_buffer *wl_buffer) {
+  struct swapchain_buffer *buffer = data;
+  buffer->isAcquired = 0;
+}
 
-  for (u16 y = 0; y < height; y++) {
-    u32 *pixel = (u32 *)row;
-    for (u16 x = 0; x < width; x++) {
-      *pixel = color;
-      pixel++;
+comptime struct wl_buffer_listener wl_buffer_listener = {
+    .release = wl_buffer_release,
+};
+
+// largest buffer that fits into framebufferArena
+#define SWAPCHAIN_WIDTH_MAX 3840
+#define SWAPCHAIN_HEIGHT_MAX 2160
+#define SWAPCHAIN_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/*
+ * Creates buffers with given size, destroying old ones if there are any.
+ * Buffers are placed back to back into arena, so one wl_shm_pool can hold
+ * them.
+ * With isHugePage pool is backed by hugetlbfs when system has huge pages
+ * reserved, otherwise by transparent huge pages. Either way it is faulted in
+ * here, so first draw does not take a page fault for every 4K.
+ * Without wl_shm buffers are only memory, for headless platform.
+ * Caller must make sure no buffer is being drawn.
+ */
+internal enum error_tag SwapchainResize(struct swapchain *swapchain,
+                                        struct wl_shm *wl_shm,
+                                        struct memory_arena *arena,
+                                        struct framebuffer *framebuffer,
+                                        u16 width, u16 height) {
+  debug_assert(width <= SWAPCHAIN_WIDTH_MAX && height <= SWAPCHAIN_HEIGHT_MAX);
+
+  // - destroy old buffers
+  // compositor has its own mapping of old pool, it can keep showing them
+  if (swapchain->bufferMemory.arena) {
+    MemoryTempEnd(&swapchain->bufferMemory);
+    MemoryArenaDecommit(arena, arena->used);
+  }
+  for (u32 index = 0; index < ARRAY_SIZE(swapchain->buffers); index++) {
+    struct swapchain_buffer *buffer = swapchain->buffers + index;
+    if (buffer->wl_buffer)
+      wl_buffer_destroy(buffer->wl_buffer);
+    *buffer = (struct swapchain_buffer){};
+  }
+  swapchain->bufferMemory = MemoryTempBegin(arena);
+
+  // - allocate buffers
+  framebuffer->width = width;
+  framebuffer->height = height;
+  framebuffer->stride = width * sizeof(u32);
+  u64 size = (u64)framebuffer->height * framebuffer->stride;
+
+  // wl_buffer needs to be aligned to pagesize. see: ERROR_MMAP_WL_SHM
+  u64 pagesize = (u64)sysconf(_SC_PAGESIZE);
+  size = (size + pagesize - 1) & ~(pagesize - 1);
+
+  // hugetlbfs mappings must start and end at huge page boundary
+  u64 poolAlignment =
+      swapchain->isHugePage ? SWAPCHAIN_HUGE_PAGE_SIZE : pagesize;
+  u64 poolSize = size * ARRAY_SIZE(swapchain->buffers);
+  poolSize = (poolSize + poolAlignment - 1) & ~(poolAlignment - 1);
+  u8 *poolData = MemoryArenaPush(arena, poolSize, poolAlignment);
+  if (!poolData)
+    return ERROR_OUT_OF_MEMORY;
+
+  swapchain->bufferSize = size;
+  for (u32 index = 0; index < ARRAY_SIZE(swapchain->buffers); index++) {
+    struct swapchain_buffer *buffer = swapchain->buffers + index;
+    buffer->data = poolData + index * size;
+  }
+  framebuffer->data = swapchain->buffers[0].data;
+
+  // - headless, nobody to share with
+  if (!wl_shm)
+    return ERROR_NONE;
+
+  // - share buffers with compositor
+  s32 fd = -1;
+  swapchain->isHugeTlb = 0;
+  if (swapchain->isHugePage) {
+    // fails when no huge pages are reserved, see /proc/sys/vm/nr_hugepages
+    fd = memfd_create("wl_shm", MFD_HUGETLB);
+    if (fd != -1 &&
+        (ftruncate(fd, (off_t)poolSize) == -1 ||
+         mmap(poolData, poolSize, PROT_READ | PROT_WRITE,
+              MAP_SHARED | MAP_FIXED | MAP_POPULATE, fd, 0) == MAP_FAILED)) {
+      close(fd);
+      fd = -1;
     }
-    row += stride;
+    swapchain->isHugeTlb = fd != -1;
   }
-}
 
-internal void DrawCheckerBoard(struct framebuffer *framebuffer, u32 lightColor,
-                               u32 darkColor, f32 offset) {
-  u16 width = framebuffer->width;
-  u16 height = framebuffer->height;
-  u16 stride = framebuffer->stride;
-  u8 *row = framebuffer->data;
+  if (!swapchain->isHugeTlb) {
+    fd = memfd_create("wl_shm", 0);
+    if (fd == -1)
+      return ERROR_MEMFD_CREATE_WL_SHM;
 
-  u16 checkerSizeInPixels = 350;
+    if (ftruncate(fd, (off_t)poolSize) == -1) {
+      close(fd);
+      return ERROR_FTRUNCATE_WL_SHM;
+    }
 
-  for (u16 y = 0; y < height; y++) {
-    u32 *pixel = (u32 *)row;
-    for (u16 x = (u16)(offset * 10.0f); x < width; x++) {
-      if (((y / checkerSizeInPixels) & 1) ^ ((x / checkerSizeInPixels) & 1))
-        *pixel = lightColor;
-      else
-        *pixel = darkColor;
+    u8 *data = mmap(poolData, poolSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_FIXED, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      return ERROR_MMAP_WL_SHM;
+    }
+
+    if (swapchain->isHugePage) {
+      // only honored when /sys/kernel/mm/transparent_hugepage/shmem_enabled
+      // is advise or always
+      madvise(poolData, poolSize, MADV_HUGEPAGE);
+      // fault in whole pool now instead of on first draw
+      for (u64 offset = 0; offset < poolSize; offset += pagesize)
+        poolData[offset] = 0;
+    }
+  }
 
-      pixel++;
+  struct wl_shm_pool *wl_shm_pool =
+      wl_shm_create_pool(wl_shm, fd, (s32)poolSize);
+  close(fd);
+  if (!wl_shm_pool)
+    return ERROR_WL_SHM_CREATE_POOL;
+
+  enum error_tag errorTag = ERROR_NONE;
+  for (u32 index = 0; index < ARRAY_SIZE(swapchain->buffers); index++) {
+    struct swapchain_buffer *buffer = swapchain->buffers + index;
+    buffer->wl_buffer = wl_shm_pool_create_buffer(
+        wl_shm_pool, (s32)(index * size), framebuffer->width,
+        framebuffer->height, framebuffer->stride, WL_SHM_FORMAT_XRGB8888);
+    if (!buffer->wl_buffer) {
+      errorTag = ERROR_WL_SHM_CREATE_POOL;
+      break;
     }
-    row += stride;
+    wl_buffer_add_listener(buffer->wl_buffer, &wl_buffer_listener, buffer);
   }
+  wl_shm_pool_destroy(wl_shm_pool);
+
+  return errorTag;
 }
 
-struct button {
-  b8 isPressed : 1;
+/*
+ * @return buffer that nobody uses, 0 when all are in use
+ */
+internal struct swapchain_buffer *
+SwapchainAcquire(struct swapchain *swapchain) {
+  for (u32 index = 0; index < ARRAY_SIZE(swapchain->buffers); index++) {
+    struct swapchain_buffer *buffer = swapchain->buffers + index;
+    if (!buffer->isAcquired) {
+      buffer->isAcquired = 1;
+      return buffer;
+    }
+  }
+
+  return 0;
+}
+
+// RENDER
+#define RENDER_TILE_WIDTH 256
+#define RENDER_TILE_HEIGHT 32
+
+struct render_tile_job {
+  struct job job;
+  struct framebuffer *framebuffer;
+  struct rect rect;
+  f32 offset;
 };
 
-struct input {
-  struct button up;
-  struct button down;
-  struct button left;
-  struct button right;
+// damage of last frames, buffers older than this are repainted fully
+#define RENDER_DAMAGE_HISTORY_COUNT SWAPCHAIN_BUFFER_COUNT
+
+struct render {
+  // must be first, see RenderDone()
+  struct job_counter counter;
+  // buffer that is being drawn
+  struct swapchain_buffer *buffer;
+  struct render_tile_job *tileJobs;
+  u32 tileJobMax;
+  // signalled when all tiles of frame are drawn
+  s32 doneFd;
+  b8 isRendering : 1;
+  // buffers are recreated, next frame damages whole surface
+  b8 isSizeChanged : 1;
+
+  // frames started so far
+  u64 frameIndex;
+  f32 previousOffset;
+  // damage of frame N relative to frame N-1 is at N % count
+  struct damage damageHistory[RENDER_DAMAGE_HISTORY_COUNT];
+  // what needs to be drawn into buffer to bring it to current frame
+  struct damage repaint;
+};
+
+internal void RenderTile(struct job *job) {
+  struct render_tile_job *tileJob = (struct render_tile_job *)job;
+  PROFILER_ZONE_BEGIN("tile");
+  DrawCheckerBoardRect(tileJob->framebuffer, tileJob->rect, 0xcbd5e1,
+                       0x0f172a, tileJob->offset);
+  PROFILER_ZONE_END("tile");
+}
+
+internal void RenderDone(struct job_counter *counter) {
+  struct render *render = (struct render *)counter;
+  u64 value = 1;
+  write(render->doneFd, &value, sizeof(value));
+}
+
+/*
+ * @return damage of last started frame relative to one before
+ */
+internal struct damage *RenderGetFrameDamage(struct render *render) {
+  return render->damageHistory +
+         (render->frameIndex % RENDER_DAMAGE_HISTORY_COUNT);
+}
+
+/*
+ * @return maximum number of jobs one frame can need
+ */
+internal u32 RenderTileJobMax(u32 width, u32 height) {
+  u32 columnCount = (width + RENDER_TILE_WIDTH - 1) / RENDER_TILE_WIDTH;
+  u32 rowCount = (height + RENDER_TILE_HEIGHT - 1) / RENDER_TILE_HEIGHT;
+  // every repaint rect can touch every tile
+  return columnCount * rowCount * DAMAGE_RECT_MAX;
+}
+
+/*
+ * Finds out what changed since buffer was last drawn, splits those regions
+ * into tiles and queues them on workers.
+ * Completion is signalled through render->doneFd.
+ */
+internal void RenderBegin(struct render *render, struct job_queue *jobQueue,
+                          struct framebuffer *framebuffer,
+                          struct swapchain_buffer *buffer, f32 offset) {
+  debug_assert(!render->isRendering);
+  render->isRendering = 1;
+  render->buffer = buffer;
+  framebuffer->data = buffer->data;
+
+  struct rect fullRect = {.width = framebuffer->width,
+                          .height = framebuffer->height};
+
+  // - damage of this frame
+  render->frameIndex++;
+  DamageReset(&framebuffer->damage);
+  if (render->frameIndex == 1 || render->isSizeChanged)
+    DamageAdd(&framebuffer->damage, fullRect);
+  else
+    DrawCheckerBoardDamage(framebuffer, render->previousOffset, offset);
+  render->previousOffset = offset;
+  render->isSizeChanged = 0;
+  *RenderGetFrameDamage(render) = framebuffer->damage;
+
+  // - accumulate damage of frames that buffer missed
+  struct damage *repaint = &render->repaint;
+  u64 age = buffer->frameIndex == 0 ? 0
+                                     : render->frameIndex - buffer->frameIndex;
+  DamageReset(repaint);
+  if (age == 0 || age > RENDER_DAMAGE_HISTORY_COUNT) {
+    DamageAdd(repaint, fullRect);
+  } else {
+    for (u64 frameIndex = buffer->frameIndex + 1;
+         frameIndex <= render->frameIndex; frameIndex++)
+      DamageUnion(repaint,
+                  render->damageHistory +
+                      (frameIndex % RENDER_DAMAGE_HISTORY_COUNT));
+  }
+  buffer->frameIndex = render->frameIndex;
+
+  // - split repaint regions at tile boundaries
+  u32 tileCount = 0;
+  for (u32 rectIndex = 0; rectIndex < repaint->count; rectIndex++) {
+    struct rect rect = repaint->rects[rectIndex];
+    u32 x0 = rect.x / RENDER_TILE_WIDTH * RENDER_TILE_WIDTH;
+    u32 y0 = rect.y / RENDER_TILE_HEIGHT * RENDER_TILE_HEIGHT;
+    u32 x1 = (u32)rect.x + rect.width;
+    u32 y1 = (u32)rect.y + rect.height;
+    for (u32 y = y0; y < y1; y += RENDER_TILE_HEIGHT) {
+      for (u32 x = x0; x < x1; x += RENDER_TILE_WIDTH) {
+        struct rect tile = {.x = (u16)x,
+                            .y = (u16)y,
+                            .width = RENDER_TILE_WIDTH,
+                            .height = RENDER_TILE_HEIGHT};
+        tile = RectIntersect(FramebufferClipRect(framebuffer, tile), rect);
+        if (IsRectEmpty(tile))
+          continue;
+
+        debug_assert(tileCount < render->tileJobMax);
+        struct render_tile_job *tileJob = render->tileJobs + tileCount;
+        *tileJob = (struct render_tile_job){
+            .job = {.work = RenderTile, .counter = &render->counter},
+            .framebuffer = framebuffer,
+            .rect = tile,
+            .offset = offset,
+        };
+        tileCount++;
+      }
+    }
+  }
+
+  if (tileCount == 0) {
+    // nothing changed, still present frame
+    RenderDone(&render->counter);
+    return;
+  }
+
+  // counter must cover every tile before first one can finish
+  JobCounterAdd(&render->counter, tileCount);
+  for (u32 index = 0; index < tileCount; index++)
+    JobQueuePush(jobQueue, &render->tileJobs[index].job);
+  JobQueueWake(jobQueue);
+}
+
+#define INPUT_QUEUE_CAPACITY 256
+
+/*
+ * Pointer events between two wl_pointer.frame events.
+ * Mice polling at 1000Hz or more send many motions per frame of ours, they
+ * are summed here so update sees one motion per wayland frame.
+ */
+struct pointer_frame {
+  u32 time;
+  // last surface position, kept while locked pointer only moves relatively
+  f32 x;
+  f32 y;
+  f32 deltaX;
+  f32 deltaY;
+  f32 scrollX;
+  f32 scrollY;
+  b8 hasMotion : 1;
+  b8 hasScroll : 1;
 };
 
 internal struct input *InputGetKeyboardAndMouse(struct input *inputs,
@@ -104,24 +428,340 @@ internal struct input *InputGetKeyboardAndMouse(struct input *inputs,
   return keyboardAndMouseInput;
 }
 
+internal struct input *InputGetEvdev(struct input *inputs, u32 inputCount) {
+  debug_assert(inputCount > 1);
+  struct input *evdevInput = inputs + 1;
+  return evdevInput;
+}
+
+// KEY BINDINGS
+struct key_binding {
+  xkb_keysym_t keysym;
+  // bitmask of enum action
+  u32 actions;
+};
+
+comptime struct key_binding DefaultKeyBindings[] = {
+    {XKB_KEY_w, ACTION_UP},   {XKB_KEY_s, ACTION_DOWN},
+    {XKB_KEY_q, ACTION_DOWN}, {XKB_KEY_a, ACTION_LEFT},
+    {XKB_KEY_d, ACTION_RIGHT},
+};
+
+// evdev codes are below 0x300, xkb adds 8
+#define KEY_ACTION_TABLE_COUNT 1024
+
+/*
+ * Keysym of a key only changes with keymap or modifiers, so bindings are
+ * resolved for every keycode then and key events need one lookup.
+ */
+struct key_action_table {
+  // bitmask of enum action for each xkb keycode
+  u32 actions[KEY_ACTION_TABLE_COUNT];
+  // actions of held keys as resolved at press, release must undo those even
+  // when modifiers changed in between
+  u32 pressedActions[KEY_ACTION_TABLE_COUNT];
+  const struct key_binding *bindings;
+  u32 bindingCount;
+};
+
+internal void KeyActionTableBuild(struct key_action_table *table,
+                                  struct xkb_state *xkb_state) {
+  bzero(table->actions, sizeof(table->actions));
+  if (!xkb_state)
+    return;
+
+  struct xkb_keymap *xkb_keymap = xkb_state_get_keymap(xkb_state);
+  xkb_keycode_t min = xkb_keymap_min_keycode(xkb_keymap);
+  xkb_keycode_t max = xkb_keymap_max_keycode(xkb_keymap);
+  if (max >= KEY_ACTION_TABLE_COUNT)
+    max = KEY_ACTION_TABLE_COUNT - 1;
+
+  for (xkb_keycode_t keycode = min; keycode <= max; keycode++) {
+    xkb_keysym_t keysym = xkb_state_key_get_one_sym(xkb_state, keycode);
+    if (keysym == XKB_KEY_NoSymbol)
+      continue;
+
+    for (u32 index = 0; index < table->bindingCount; index++) {
+      const struct key_binding *binding = table->bindings + index;
+      if (binding->keysym == keysym)
+        table->actions[keycode] |= binding->actions;
+    }
+  }
+}
+
+/*
+ * Remaps keys at runtime. Bindings must outlive table.
+ */
+internal void KeyActionTableSetBindings(struct key_action_table *table,
+                                        struct xkb_state *xkb_state,
+                                        const struct key_binding *bindings,
+                                        u32 bindingCount) {
+  table->bindings = bindings;
+  table->bindingCount = bindingCount;
+  KeyActionTableBuild(table, xkb_state);
+}
+
+// KEYMAP CACHE
+#define KEYMAP_CACHE_COUNT 4
+
+struct keymap_cache_entry {
+  // of keymap text compositor sent
+  u64 hash;
+  u32 size;
+  // cache holds its own reference
+  struct xkb_keymap *xkb_keymap;
+  // least recently used entry is evicted first
+  u64 usedAt;
+};
+
+/*
+ * Compositors resend same keymap on every seat capability or layout change.
+ * Compiling it again takes milliseconds, so compiled keymaps are kept by
+ * hash of their text.
+ */
+struct keymap_cache {
+  struct keymap_cache_entry entries[KEYMAP_CACHE_COUNT];
+  u64 useCount;
+};
+
+/*
+ * @return keymap compiled from same text before, 0 when there is none
+ */
+internal struct xkb_keymap *KeymapCacheFind(struct keymap_cache *cache,
+                                            u64 hash, u32 size) {
+  for (u32 index = 0; index < ARRAY_SIZE(cache->entries); index++) {
+    struct keymap_cache_entry *entry = cache->entries + index;
+    if (entry->xkb_keymap && entry->hash == hash && entry->size == size) {
+      entry->usedAt = ++cache->useCount;
+      return entry->xkb_keymap;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Takes over reference of xkb_keymap.
+ */
+internal void KeymapCacheInsert(struct keymap_cache *cache, u64 hash, u32 size,
+                                struct xkb_keymap *xkb_keymap) {
+  struct keymap_cache_entry *evicted = cache->entries;
+  for (u32 index = 1; index < ARRAY_SIZE(cache->entries); index++) {
+    struct keymap_cache_entry *entry = cache->entries + index;
+    if (entry->usedAt < evicted->usedAt)
+      evicted = entry;
+  }
+
+  // keymap that is in use stays alive through its xkb_state
+  xkb_keymap_unref(evicted->xkb_keymap);
+  *evicted = (struct keymap_cache_entry){
+      .hash = hash,
+      .size = size,
+      .xkb_keymap = xkb_keymap,
+      .usedAt = ++cache->useCount,
+  };
+}
+
+internal void KeymapCacheRelease(struct keymap_cache *cache) {
+  for (u32 index = 0; index < ARRAY_SIZE(cache->entries); index++)
+    xkb_keymap_unref(cache->entries[index].xkb_keymap);
+  *cache = (struct keymap_cache){};
+}
+
 // TIME
 internal u64 Now(void) {
   struct timespec ts;
-  debug_assert(clock_gettime(CLOCK_MONOTONIC, &ts) != -1);
+  // must not be inside debug_assert, release builds would not read clock
+  clock_gettime(CLOCK_MONOTONIC, &ts);
   return ((u64)ts.tv_sec * 1000000000 /* 1e9 */) + (u64)ts.tv_nsec;
 }
 
+// FRAME PACING
+// time compositor needs between our commit and its repaint
+#define FRAME_PACER_COMMIT_MARGIN 2000000 /* 2ms */
+// pacer is trusted only while presentations keep arriving
+#define FRAME_PACER_TIMEOUT 100000000 /* 100ms */
+// used when window is hidden and compositor stops driving frames
+#define BACKGROUND_FRAME_INTERVAL 33333333 /* 33.333333ms */
+
+/*
+ * Predicts next vblank from wp_presentation feedback and starts rendering
+ * just long enough before it to make it, instead of rendering at fixed rate.
+ */
+struct frame_pacer {
+  clockid_t clockId;
+  // CLOCK_MONOTONIC time that last frame was shown on screen
+  u64 presentedAt;
+  // 0 when compositor does not know
+  u64 refreshInterval;
+  u64 renderStartedAt;
+  // smoothed time from starting render to commit
+  u64 renderDuration;
+
+  // absolute CLOCK_MONOTONIC time of next render
+  struct __kernel_timespec renderAt;
+  b8 isRenderScheduled : 1;
+};
+
+internal b8 FramePacerIsActive(struct frame_pacer *pacer, u64 now) {
+  return pacer->refreshInterval != 0 &&
+         now - pacer->presentedAt < FRAME_PACER_TIMEOUT;
+}
+
+internal void FramePacerRecordRender(struct frame_pacer *pacer, u64 now) {
+  u64 duration = now - pacer->renderStartedAt;
+  if (pacer->renderDuration == 0)
+    pacer->renderDuration = duration;
+  else
+    pacer->renderDuration = (pacer->renderDuration * 7 + duration) / 8;
+}
+
+/*
+ * @return time to start rendering so that frame is ready before the earliest
+ *         vblank that can still be reached
+ */
+internal u64 FramePacerNextRenderAt(struct frame_pacer *pacer, u64 now) {
+  debug_assert(pacer->refreshInterval != 0);
+  u64 budget = pacer->renderDuration + FRAME_PACER_COMMIT_MARGIN;
+  u64 vblankAt = pacer->presentedAt + pacer->refreshInterval;
+  if (vblankAt < now + budget) {
+    u64 missedCount =
+        (now + budget - vblankAt + pacer->refreshInterval - 1) /
+        pacer->refreshInterval;
+    vblankAt += missedCount * pacer->refreshInterval;
+  }
+  return vblankAt - budget;
+}
+
+// KEY REPEAT
+// used until compositor sends wl_keyboard.repeat_info
+#define KEY_REPEAT_RATE 25
+#define KEY_REPEAT_DELAY 600
+
+/*
+ * Held key repeats on timeout of io_uring, there is no thread or timerfd
+ * for it.
+ * At most one timeout is in flight. It is rearmed only from its completion,
+ * so timeout of a released key can never repeat key pressed after it.
+ */
+struct key_repeat {
+  // repeats per second, 0 disables repeat
+  u32 rate;
+  // milliseconds from press to first repeat
+  u32 delay;
+
+  // xkb keycode of held key, 0 when none
+  u32 key;
+  u32 actions;
+  // compositor time of next repeat, in milliseconds
+  u32 time;
+  // CLOCK_MONOTONIC time of next repeat
+  u64 repeatAt;
+  struct __kernel_timespec timeoutAt;
+  b8 isTimeoutArmed : 1;
+};
+
+// DYNAMIC RESOLUTION
+// buffer is at least this fraction of window, compositor scales it up
+#define RENDER_SCALE_MIN 0.5f
+#define RENDER_SCALE_STEP 0.125f
+// frames to wait after changing scale, first ones are full repaints
+#define RENDER_SCALE_COOLDOWN 60
+
+// LOG
+// size of each of two log buffers
+#define LOG_BUFFER_SIZE (64 * 1024)
+
+// PROFILER
+// zone begin and end events kept per thread, must be power of 2
+#define PROFILER_EVENT_COUNT (1 << 13)
+
+// PLATFORM
+enum platform {
+  // window on wayland compositor
+  PLATFORM_WAYLAND,
+  // no display, frames are drawn into memory and frame done is simulated
+  PLATFORM_HEADLESS,
+};
+
+// frame done interval of simulated compositor, 60Hz
+#define HEADLESS_FRAME_INTERVAL 16666667
+
+// FRAME STATS
+// frames that percentiles are computed from, must be power of 2
+#define FRAME_STATS_COUNT 4096
+
+// SIMULATION
+// default steps per second, see --tick-rate
+#define SIMULATION_RATE 60
+// steps run at most in one frame, rest of a stall is dropped
+#define SIMULATION_STEP_MAX 8
+
+struct game_state {
+  f32 offset;
+};
+
+// RING
+// ops in flight at most: wayland, timers, render done, log, evdev devices,
+// memory stats and removes, with room for many more
+#define RING_ENTRY_COUNT 64
+// with --sqpoll, kernel thread sleeps after this many milliseconds idle
+#define RING_SQ_THREAD_IDLE 100
+
+// ASSET
+// holds paths, files and decoded assets of one level
+#define ASSET_MEMORY_SIZE (32 * 1024 * 1024)
+// log buffers are registered at 0 and 1
+#define ASSET_BUFFER_INDEX 2
+
+/*
+ * Reading of one asset file through ring: open, statx, read until whole
+ * file is in memory, close.
+ */
+struct asset_read {
+  struct asset *asset;
+  // -1 while opening
+  s32 fd;
+  struct statx statx;
+  // bytes of file in memory so far
+  u64 readSize;
+  u64 startedAt;
+};
+
+struct asset_stream {
+  // must be first, see AssetStreamDone()
+  struct asset_loader loader;
+  // same index as loader->assets
+  struct asset_read reads[ASSET_MAX];
+  // signalled by workers when assets are decoded
+  s32 doneFd;
+  // loader memory is registered to io_uring, see AssetReadSubmit()
+  b8 isBufferRegistered : 1;
+};
+
+// EVDEV
+#define EVDEV_DEVICE_MAX 4
+#define EVDEV_DIRECTORY "/dev/input"
+
 struct linux_context {
+  enum platform platform;
+
   // memory
   struct memory_arena memoryArena;
   struct memory_arena framebufferArena;
-  struct memory_arena xkbArena;
 
   // image
   struct framebuffer framebuffer;
+  struct render render;
+
+  // threads
+  struct job_queue jobQueue;
+  struct profiler profiler;
 
   // string
   struct string_builder stringBuilder;
+  struct log log;
+  // log buffers are registered to io_uring, see LogSubmit()
+  b8 isLogBufferRegistered : 1;
 
   // wayland globals
   struct wl_display *wl_display;
@@ -131,58 +771,1049 @@ struct linux_context {
   struct xdg_wm_base *xdg_wm_base;
   struct wl_seat *wl_seat;
   struct wp_content_type_manager_v1 *wp_content_type_manager_v1;
+  struct wp_presentation *wp_presentation;
+  struct wp_viewporter *wp_viewporter;
+  struct zwp_relative_pointer_manager_v1 *zwp_relative_pointer_manager_v1;
+  struct zwp_pointer_constraints_v1 *zwp_pointer_constraints_v1;
 
   // wayland objects
   struct wl_surface *wl_surface;
   struct xdg_surface *xdg_surface;
   struct xdg_toplevel *xdg_toplevel;
-  struct wl_buffer *wl_buffer;
+  struct wp_viewport *wp_viewport;
+  struct swapchain swapchain;
   struct wl_keyboard *wl_keyboard;
   struct wl_pointer *wl_pointer;
+  struct zwp_relative_pointer_v1 *zwp_relative_pointer_v1;
+  struct zwp_locked_pointer_v1 *zwp_locked_pointer_v1;
 
   // xkb
   struct xkb_context *xkb_context;
   struct xkb_keymap *xkb_keymap;
   struct xkb_state *xkb_state;
+  struct keymap_cache keymapCache;
+  struct key_action_table keyActionTable;
+  struct key_repeat keyRepeat;
 
   struct io_uring *ring;
-  void *gameLoopOp;
+  // io_uring_enter calls made by game loop
+  u64 ringEnterCount;
+  // compositor is ready for next frame, handled after dispatch
+  b8 isFrameDonePending : 1;
+
+  struct frame_pacer framePacer;
+  u64 previousFrameAt;
+  // time from update start to render done
+  struct frame_stats frameStats;
+  // close after this many frames are drawn, 0 means never
+  u64 frameLimit;
+
+  // in surface coordinates
+  u16 windowWidth;
+  u16 windowHeight;
+  // buffer size relative to window, only below 1 with wp_viewport
+  f32 renderScale;
+  u64 renderScaleChangedAt;
+  b8 isResizePending : 1;
+  // set when window must close because of error
+  enum error_tag errorTag;
 
   b8 isXDGSurfaceConfigured : 1;
   b8 isWindowClosed : 1;
 
+  // 0: wayland keyboard and mouse, 1: evdev devices
   struct input inputs[2];
+  // filled by wayland dispatch, drained by update
+  struct input_queue inputQueue;
+  struct pointer_frame pointerFrame;
+  // compositor groups pointer events, wl_pointer version 5 and later
+  b8 isPointerFrameSupported : 1;
+  // lock pointer to window and hide cursor, for mouse look
+  b8 isPointerLockEnabled : 1;
+  // read directly, without compositor in between
+  struct evdev_device evdevDevices[EVDEV_DEVICE_MAX];
+
+  struct asset_stream assetStream;
+
+  // simulation runs at fixed rate, frames draw between last two states
+  struct fixed_step fixedStep;
+  struct game_state previousGameState;
+  struct game_state gameState;
+};
 
-  f32 offset;
+/*
+ * Ops are only queued, game loop submits all of them at once when it waits.
+ * Queue is submitted early only if it is full.
+ */
+internal struct io_uring_sqe *RingGetSqe(struct linux_context *context) {
+  struct io_uring_sqe *sqe = io_uring_get_sqe(context->ring);
+  if (!sqe) {
+    io_uring_submit(context->ring);
+    context->ringEnterCount++;
+    sqe = io_uring_get_sqe(context->ring);
+  }
+  debug_assert(sqe);
+  return sqe;
+}
+
+/*
+ * Submits queued ops and waits for completion, in one io_uring_enter.
+ * Does not enter kernel when completion is ready and nothing is queued.
+ * @return 0 on success, -errno otherwise
+ */
+internal s32 RingSubmitAndWait(struct linux_context *context,
+                               struct io_uring_cqe **cqe) {
+  struct io_uring *ring = context->ring;
+  if (io_uring_sq_ready(ring) == 0 && io_uring_peek_cqe(ring, cqe) == 0)
+    return 0;
+
+  context->ringEnterCount++;
+  s32 error = io_uring_submit_and_wait(ring, 1);
+  if (error < 0)
+    return error;
+  return io_uring_peek_cqe(ring, cqe);
+}
+
+/*
+ * Queues write of log batch to stdout.
+ * Terminal or pipe that is slow to read only delays this write, messages
+ * meanwhile go into other log buffer.
+ */
+internal void LogSubmit(struct linux_context *context, struct string pending) {
+  struct log *log = &context->log;
+  struct io_uring_sqe *sqe = RingGetSqe(context);
+  // -1 means write at current file position, works with pipes and ttys
+  u64 offset = (u64)-1;
+  if (context->isLogBufferRegistered)
+    io_uring_prep_write_fixed(sqe, STDOUT_FILENO, pending.value,
+                              (u32)pending.length, offset,
+                              (s32)(log->fillIndex ^ 1));
+  else
+    io_uring_prep_write(sqe, STDOUT_FILENO, pending.value, (u32)pending.length,
+                        offset);
+  io_uring_sqe_set_data(sqe, log);
+}
+
+/*
+ * Opens event devices under /dev/input that are one of kinds.
+ * Fails silently when user cannot read them, e.g. not in input group.
+ */
+internal void EvdevDevicesOpen(struct linux_context *context, u32 kinds) {
+  DIR *directory = opendir(EVDEV_DIRECTORY);
+  if (!directory)
+    return;
+
+  u32 deviceCount = 0;
+  struct dirent *entry;
+  while (deviceCount < ARRAY_SIZE(context->evdevDevices) &&
+         (entry = readdir(directory))) {
+    struct string name = StringFromZeroTerminated((u8 *)entry->d_name, 256);
+    if (!IsStringStartsWith(&name, &STRING_FROM_ZERO_TERMINATED("event")))
+      continue;
+
+    // /dev/input/eventN
+    char path[sizeof(EVDEV_DIRECTORY) + 256];
+    memcpy(path, EVDEV_DIRECTORY "/", sizeof(EVDEV_DIRECTORY));
+    memcpy(path + sizeof(EVDEV_DIRECTORY), name.value, name.length);
+    path[sizeof(EVDEV_DIRECTORY) + name.length] = 0;
+
+    struct evdev_device *device = context->evdevDevices + deviceCount;
+    if (!EvdevDeviceOpen(device, path, kinds))
+      continue;
+    deviceCount++;
+
+    struct string_builder *stringBuilder = &context->stringBuilder;
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED("evdev: "));
+    struct string pathString =
+        StringFromZeroTerminated((u8 *)path, sizeof(path));
+    StringBuilderAppendString(stringBuilder, &pathString);
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED(" "));
+    struct string deviceName = StringFromZeroTerminated(
+        (u8 *)libevdev_get_name(device->libevdev), 256);
+    StringBuilderAppendString(stringBuilder, &deviceName);
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED("\n"));
+    struct string string = StringBuilderFlush(stringBuilder);
+    LogAppend(&context->log, &string);
+  }
+
+  closedir(directory);
+}
+
+/*
+ * Device fd is polled instead of read, because libevdev does the reading.
+ * It must see every SYN_DROPPED to resync state kernel dropped.
+ */
+internal void EvdevDevicePoll(struct linux_context *context,
+                              struct evdev_device *device) {
+  struct io_uring_sqe *sqe = RingGetSqe(context);
+  io_uring_prep_poll_multishot(sqe, device->fd, POLLIN);
+  io_uring_sqe_set_data(sqe, device);
+}
+
+/*
+ * Completion of poll removed when device was closed also ends up here, it
+ * belongs to no device.
+ *
+ * @return open device that completion belongs to, 0 when none
+ */
+internal struct evdev_device *EvdevDeviceFromData(struct linux_context *context,
+                                                  void *data) {
+  for (u32 index = 0; index < ARRAY_SIZE(context->evdevDevices); index++) {
+    struct evdev_device *device = context->evdevDevices + index;
+    if (data == device && device->fd != -1)
+      return device;
+  }
+  return 0;
+}
+
+internal void KeyRepeatArm(struct linux_context *context) {
+  struct key_repeat *repeat = &context->keyRepeat;
+  repeat->timeoutAt.tv_sec = (s64)(repeat->repeatAt / 1000000000 /* 1e9 */);
+  repeat->timeoutAt.tv_nsec = (s64)(repeat->repeatAt % 1000000000 /* 1e9 */);
+  repeat->isTimeoutArmed = 1;
+
+  struct io_uring_sqe *sqe = RingGetSqe(context);
+  io_uring_prep_timeout(sqe, &repeat->timeoutAt, 0, IORING_TIMEOUT_ABS);
+  io_uring_sqe_set_data(sqe, repeat);
+}
+
+/*
+ * Timeout completes with -ECANCELED, unless it already expired.
+ */
+internal void KeyRepeatCancel(struct linux_context *context) {
+  struct key_repeat *repeat = &context->keyRepeat;
+  if (!repeat->isTimeoutArmed)
+    return;
+
+  struct io_uring_sqe *sqe = RingGetSqe(context);
+  io_uring_prep_timeout_remove(sqe, (u64)repeat, 0);
+  // result of remove itself is not needed
+  io_uring_sqe_set_data(sqe, 0);
+}
+
+/*
+ * @param time compositor time of press, in milliseconds
+ */
+internal void KeyRepeatStart(struct linux_context *context, u32 key,
+                             u32 actions, u32 time) {
+  struct key_repeat *repeat = &context->keyRepeat;
+  if (repeat->rate == 0)
+    return;
+
+  repeat->key = key;
+  repeat->actions = actions;
+  repeat->time = time + repeat->delay;
+  repeat->repeatAt = Now() + (u64)repeat->delay * 1000000 /* 1e6 */;
+
+  // timeout of previous key rearms for this one when it completes
+  if (repeat->isTimeoutArmed)
+    KeyRepeatCancel(context);
+  else
+    KeyRepeatArm(context);
+}
+
+internal void KeyRepeatStop(struct linux_context *context) {
+  struct key_repeat *repeat = &context->keyRepeat;
+  repeat->key = 0;
+  KeyRepeatCancel(context);
+}
+
+/*
+ * Called on every completion of key repeat timeout, expired or cancelled.
+ */
+internal void KeyRepeatTimeout(struct linux_context *context, u64 now) {
+  struct key_repeat *repeat = &context->keyRepeat;
+  repeat->isTimeoutArmed = 0;
+  if (repeat->key == 0 || repeat->rate == 0)
+    return;
+
+  if (now >= repeat->repeatAt) {
+    struct input_queue_event event = {
+        .time = repeat->time,
+        .type = INPUT_EVENT_KEY,
+        .isPressed = 1,
+        .isRepeat = 1,
+        .code = repeat->key,
+        .actions = repeat->actions,
+    };
+    InputQueuePush(&context->inputQueue, &event);
+
+    u64 interval = 1000000000 /* 1e9 */ / repeat->rate;
+    repeat->repeatAt += interval;
+    repeat->time += 1000 / repeat->rate;
+    // loop was stalled, do not burst repeats that were missed
+    if (repeat->repeatAt <= now)
+      repeat->repeatAt = now + interval;
+  }
+
+  KeyRepeatArm(context);
+}
+
+internal void AssetStreamDone(struct asset_loader *loader) {
+  struct asset_stream *stream = (struct asset_stream *)loader;
+  u64 value = 1;
+  write(stream->doneFd, &value, sizeof(value));
+}
+
+/*
+ * Completion of close belongs to no read, its data is 0.
+ */
+internal struct asset_read *AssetReadFromData(struct linux_context *context,
+                                              void *data) {
+  struct asset_stream *stream = &context->assetStream;
+  for (u32 index = 0; index < stream->loader.assetCount; index++) {
+    struct asset_read *read = stream->reads + index;
+    if (data == read)
+      return read;
+  }
+  return 0;
+}
+
+/*
+ * Queues read of rest of file.
+ */
+internal void AssetReadSubmit(struct linux_context *context,
+                              struct asset_read *read) {
+  struct asset *asset = read->asset;
+  u8 *buffer = asset->file + read->readSize;
+  u32 length = (u32)(asset->fileSize - read->readSize);
+  struct io_uring_sqe *sqe = RingGetSqe(context);
+  // - kernel does not need to map pages of registered buffer on every read
+  if (context->assetStream.isBufferRegistered)
+    io_uring_prep_read_fixed(sqe, read->fd, buffer, length, read->readSize,
+                             ASSET_BUFFER_INDEX);
+  else
+    io_uring_prep_read(sqe, read->fd, buffer, length, read->readSize);
+  io_uring_sqe_set_data(sqe, read);
+}
+
+internal void AssetReadFail(struct linux_context *context,
+                            struct asset_read *read) {
+  if (read->fd != -1) {
+    struct io_uring_sqe *sqe = RingGetSqe(context);
+    io_uring_prep_close(sqe, read->fd);
+    io_uring_sqe_set_data(sqe, 0);
+    read->fd = -1;
+  }
+  AssetLoaderComplete(&context->assetStream.loader, read->asset,
+                      ASSET_STATE_FAILED);
+}
+
+/*
+ * Starts loading file at path. Game loop is told when it is done, see
+ * AssetStreamDone().
+ */
+internal void AssetStreamLoad(struct linux_context *context,
+                              struct string *path) {
+  struct asset_stream *stream = &context->assetStream;
+  struct asset *asset = AssetLoaderAdd(&stream->loader, path);
+  if (!asset) {
+    LogAppend(&context->log,
+              &STRING_FROM_ZERO_TERMINATED("asset: no room for more\n"));
+    return;
+  }
+
+  struct asset_read *read = stream->reads + (asset - stream->loader.assets);
+  *read = (struct asset_read){.asset = asset, .fd = -1, .startedAt = Now()};
+
+  struct io_uring_sqe *sqe = RingGetSqe(context);
+  io_uring_prep_openat(sqe, AT_FDCWD, (char *)asset->path.value,
+                       O_RDONLY | O_CLOEXEC, 0);
+  io_uring_sqe_set_data(sqe, read);
+}
+
+/*
+ * Advances read after its op completed.
+ * @param result of op
+ */
+internal void AssetReadStep(struct linux_context *context,
+                            struct asset_read *read, s32 result) {
+  struct asset_loader *loader = &context->assetStream.loader;
+  struct asset *asset = read->asset;
+  if (result < 0) {
+    AssetReadFail(context, read);
+    return;
+  }
+
+  // - opened
+  if (read->fd == -1) {
+    read->fd = result;
+    struct io_uring_sqe *sqe = RingGetSqe(context);
+    io_uring_prep_statx(sqe, read->fd, "", AT_EMPTY_PATH, STATX_SIZE,
+                        &read->statx);
+    io_uring_sqe_set_data(sqe, read);
+  }
+
+  // - size is known
+  else if (!asset->file) {
+    if (!AssetLoaderPushFile(loader, asset, read->statx.stx_size)) {
+      AssetReadFail(context, read);
+      return;
+    }
+    if (asset->fileSize == 0) {
+      // empty file is not valid asset
+      AssetReadFail(context, read);
+      return;
+    }
+    AssetReadSubmit(context, read);
+  }
+
+  // - read some of file
+  else {
+    // file shrunk after statx
+    if (result == 0) {
+      AssetReadFail(context, read);
+      return;
+    }
+
+    read->readSize += (u64)result;
+    if (read->readSize < asset->fileSize) {
+      AssetReadSubmit(context, read);
+      return;
+    }
+
+    struct io_uring_sqe *sqe = RingGetSqe(context);
+    io_uring_prep_close(sqe, read->fd);
+    io_uring_sqe_set_data(sqe, 0);
+    read->fd = -1;
+    AssetLoaderDecode(loader, asset, &context->jobQueue);
+  }
+}
+
+/*
+ * Hands assets that are done to game.
+ */
+internal void AssetStreamComplete(struct linux_context *context) {
+  struct asset_stream *stream = &context->assetStream;
+  struct asset *asset = AssetLoaderTakeCompleted(&stream->loader);
+  for (; asset; asset = asset->next) {
+    struct asset_read *read = stream->reads + (asset - stream->loader.assets);
+    struct string_builder *stringBuilder = &context->stringBuilder;
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED("asset: "));
+    StringBuilderAppendString(stringBuilder, &asset->path);
+    if (asset->state == ASSET_STATE_READY) {
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED(" size: "));
+      StringBuilderAppendU64(stringBuilder, asset->image.width);
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED("x"));
+      StringBuilderAppendU64(stringBuilder, asset->image.height);
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED(" took: "));
+      StringBuilderAppendU64(stringBuilder, Now() - read->startedAt);
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED("ns\n"));
+    } else {
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED(" failed\n"));
+    }
+    struct string string = StringBuilderFlush(stringBuilder);
+    LogAppend(&context->log, &string);
+  }
+}
+
+internal void FrameStatsLog(struct linux_context *context) {
+  MEMORY_SCRATCH_SCOPE(scratch, 0);
+  struct frame_stats *stats = &context->frameStats;
+  struct frame_stats_report report = FrameStatsReport(stats, scratch.arena);
+
+  struct string_builder *stringBuilder = &context->stringBuilder;
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED("frame time p50: "));
+  StringBuilderAppendU64(stringBuilder, report.p50);
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED("ns p99: "));
+  StringBuilderAppendU64(stringBuilder, report.p99);
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED("ns max: "));
+  StringBuilderAppendU64(stringBuilder, report.max);
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED("ns frames: "));
+  StringBuilderAppendU64(stringBuilder, stats->count);
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED(" skipped: "));
+  StringBuilderAppendU64(stringBuilder, stats->skippedCount);
+  StringBuilderAppendString(
+      stringBuilder, &STRING_FROM_ZERO_TERMINATED(" simulation dropped: "));
+  StringBuilderAppendU64(stringBuilder, context->fixedStep.droppedTime);
+  // - system calls spent on ring, run with --headless --frames=<count> to
+  // compare ring setups
+  f32 ringEnterPerFrame = 0.0f;
+  if (stats->count != 0)
+    ringEnterPerFrame = (f32)context->ringEnterCount / (f32)stats->count;
+  StringBuilderAppendString(
+      stringBuilder, &STRING_FROM_ZERO_TERMINATED("ns ring enters/frame: "));
+  StringBuilderAppendF32(stringBuilder, ringEnterPerFrame, 2);
+  StringBuilderAppendString(stringBuilder, &STRING_FROM_ZERO_TERMINATED("\n"));
+  struct string string = StringBuilderFlush(stringBuilder);
+  LogAppend(&context->log, &string);
+}
+
+#if IS_MEMORY_STATS_ENABLED
+internal void MemoryArenaStatsLog(struct linux_context *context,
+                                  struct string *name,
+                                  struct memory_arena *arena) {
+  struct string_builder *stringBuilder = &context->stringBuilder;
+  struct memory_arena_stats *stats = &arena->stats;
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED("memory: "));
+  StringBuilderAppendString(stringBuilder, name);
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED(" used: "));
+  StringBuilderAppendU64(stringBuilder, arena->used);
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED(" peak: "));
+  StringBuilderAppendU64(stringBuilder, stats->usedMax);
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED(" total: "));
+  StringBuilderAppendU64(stringBuilder, arena->total);
+  if (arena->flags & MEMORY_ARENA_GROWABLE) {
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED(" committed: "));
+    StringBuilderAppendU64(stringBuilder,
+                           arena->committed - arena->subCommitted);
+  }
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED(" pushes: "));
+  StringBuilderAppendU64(stringBuilder, stats->pushCount);
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED(" alignment waste: "));
+  StringBuilderAppendU64(stringBuilder, stats->alignmentWaste);
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED(" temp depth: "));
+  StringBuilderAppendU64(stringBuilder, stats->tempDepthMax);
+  StringBuilderAppendString(stringBuilder, &STRING_FROM_ZERO_TERMINATED("\n"));
+  struct string string = StringBuilderFlush(stringBuilder);
+  LogAppend(&context->log, &string);
+}
+
+/*
+ * Logs every arena owned by main thread. Done on exit and on SIGUSR1.
+ */
+internal void MemoryStatsLog(struct linux_context *context) {
+  MemoryArenaStatsLog(context, &STRING_FROM_ZERO_TERMINATED("memoryArena"),
+                      &context->memoryArena);
+  MemoryArenaStatsLog(context,
+                      &STRING_FROM_ZERO_TERMINATED("framebufferArena"),
+                      &context->framebufferArena);
+  MemoryArenaStatsLog(context, &STRING_FROM_ZERO_TERMINATED("assetArena"),
+                      &context->assetStream.loader.memory);
+  for (u32 index = 0; index < MEMORY_SCRATCH_COUNT; index++) {
+    struct memory_arena *scratch = MemoryScratchArenas + index;
+    if (!scratch->block)
+      continue;
+    MemoryArenaStatsLog(context, &STRING_FROM_ZERO_TERMINATED("scratch"),
+                        scratch);
+  }
+}
+#endif
+
+/*
+ * Recreates swapchain for current window size and render scale.
+ */
+internal enum error_tag WindowResize(struct linux_context *context) {
+  debug_assert(!context->render.isRendering);
+  context->isResizePending = 0;
+
+  u32 width = (u32)((f32)context->windowWidth * context->renderScale);
+  u32 height = (u32)((f32)context->windowHeight * context->renderScale);
+  width = width < 1                     ? 1
+          : width > SWAPCHAIN_WIDTH_MAX ? SWAPCHAIN_WIDTH_MAX
+                                        : width;
+  height = height < 1                      ? 1
+           : height > SWAPCHAIN_HEIGHT_MAX ? SWAPCHAIN_HEIGHT_MAX
+                                           : height;
+
+  enum error_tag errorTag = SwapchainResize(
+      &context->swapchain, context->wl_shm, &context->framebufferArena,
+      &context->framebuffer, (u16)width, (u16)height);
+  if (errorTag != ERROR_NONE)
+    return errorTag;
+
+  // - let compositor scale buffer to window
+  if (context->wp_viewport)
+    wp_viewport_set_destination(context->wp_viewport, context->windowWidth,
+                                context->windowHeight);
+
+  context->render.isSizeChanged = 1;
+  return ERROR_NONE;
+}
+
+/*
+ * Lowers resolution when drawing takes more than half of refresh interval,
+ * raises it back when it takes less than quarter.
+ */
+internal void RenderScaleUpdate(struct linux_context *context) {
+  struct frame_pacer *pacer = &context->framePacer;
+  struct render *render = &context->render;
+  if (!context->wp_viewport || pacer->refreshInterval == 0 ||
+      render->frameIndex - context->renderScaleChangedAt <
+          RENDER_SCALE_COOLDOWN)
+    return;
+
+  f32 renderScale = context->renderScale;
+  if (pacer->renderDuration > pacer->refreshInterval / 2)
+    renderScale -= RENDER_SCALE_STEP;
+  else if (pacer->renderDuration < pacer->refreshInterval / 4)
+    renderScale += RENDER_SCALE_STEP;
+
+  if (renderScale < RENDER_SCALE_MIN)
+    renderScale = RENDER_SCALE_MIN;
+  else if (renderScale > 1.0f)
+    renderScale = 1.0f;
+
+  if (renderScale == context->renderScale)
+    return;
+
+  context->renderScale = renderScale;
+  context->renderScaleChangedAt = render->frameIndex;
+  context->isResizePending = 1;
+}
+
+/*
+ * Applies input events since last update in order they happened.
+ */
+internal void InputUpdate(struct linux_context *context) {
+  struct input *input =
+      InputGetKeyboardAndMouse(context->inputs, ARRAY_SIZE(context->inputs));
+
+  struct input_queue_event event;
+  while (InputQueuePop(&context->inputQueue, &event)) {
+    switch (event.type) {
+    case INPUT_EVENT_KEY: {
+      if (event.actions == 0)
+        break;
+      InputSetActions(input, event.actions, event.isPressed);
+
+      struct string_builder *stringBuilder = &context->stringBuilder;
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED("key time: "));
+      StringBuilderAppendU64(stringBuilder, event.time);
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED(" state "));
+      StringBuilderAppendU64(stringBuilder, event.isPressed);
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED(" repeat: "));
+      StringBuilderAppendU64(stringBuilder, event.isRepeat);
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED(" up: "));
+      StringBuilderAppendU64(stringBuilder, input->up.isPressed);
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED(" down: "));
+      StringBuilderAppendU64(stringBuilder, input->down.isPressed);
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED(" left: "));
+      StringBuilderAppendU64(stringBuilder, input->left.isPressed);
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED(" right: "));
+      StringBuilderAppendU64(stringBuilder, input->right.isPressed);
+      StringBuilderAppendString(stringBuilder,
+                                &STRING_FROM_ZERO_TERMINATED("\n"));
+      struct string string = StringBuilderFlush(stringBuilder);
+      LogAppend(&context->log, &string);
+    } break;
+
+    case INPUT_EVENT_POINTER_MOTION: {
+      input->pointerX = event.x;
+      input->pointerY = event.y;
+      input->pointerDeltaX += event.deltaX;
+      input->pointerDeltaY += event.deltaY;
+    } break;
+
+    case INPUT_EVENT_POINTER_BUTTON: {
+      struct button *button = event.code == BTN_LEFT    ? &input->pointerLeft
+                              : event.code == BTN_RIGHT ? &input->pointerRight
+                              : event.code == BTN_MIDDLE
+                                  ? &input->pointerMiddle
+                                  : 0;
+      if (button)
+        ButtonSet(button, event.isPressed);
+    } break;
+
+    case INPUT_EVENT_POINTER_AXIS: {
+      input->scrollX += event.x;
+      input->scrollY += event.y;
+    } break;
+    }
+  }
+
+  // - simulation missed transitions, tell reader
+  u32 droppedCount = InputQueueTakeDropped(&context->inputQueue);
+  if (droppedCount != 0) {
+    struct string_builder *stringBuilder = &context->stringBuilder;
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED("input: dropped "));
+    StringBuilderAppendU64(stringBuilder, droppedCount);
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED(" events\n"));
+    struct string string = StringBuilderFlush(stringBuilder);
+    LogAppend(&context->log, &string);
+  }
+}
+
+/*
+ * Advances game state by one fixed step.
+ */
+internal void GameUpdate(struct game_state *state, struct input *inputs,
+                         u32 inputCount, f32 deltaTime) {
+  (void)inputs;
+  (void)inputCount;
+  f32 speed = 5.0f;
+  state->offset += deltaTime * speed;
+}
+
+/*
+ * @return state at alpha between previous and current step
+ */
+internal struct game_state GameStateInterpolate(struct game_state *previous,
+                                                struct game_state *current,
+                                                f32 alpha) {
+  return (struct game_state){
+      .offset = previous->offset + (current->offset - previous->offset) * alpha,
+  };
+}
+
+/*
+ * Updates game state and starts drawing it.
+ */
+internal void Frame(struct linux_context *context, u64 now,
+                    b8 isFrameDoneEvent) {
+  PROFILER_ZONE_BEGIN("update");
+  InputUpdate(context);
+
+  // - simulate in fixed steps, cost of a stall is at most
+  // SIMULATION_STEP_MAX steps and result does not depend on frame rate
+  u64 elapsed = now - context->previousFrameAt;
+  struct fixed_step *fixedStep = &context->fixedStep;
+  u32 stepCount = FixedStepAdvance(fixedStep, elapsed);
+  for (u32 step = 0; step < stepCount; step++) {
+    context->previousGameState = context->gameState;
+    GameUpdate(&context->gameState, context->inputs,
+               ARRAY_SIZE(context->inputs), FixedStepSeconds(fixedStep));
+    // - transitions go to first step only, later steps see held buttons
+    // frames without step keep them, so taps between steps are not lost
+    for (u32 index = 0; index < ARRAY_SIZE(context->inputs); index++)
+      InputEndFrame(context->inputs + index);
+  }
+  struct game_state renderState =
+      GameStateInterpolate(&context->previousGameState, &context->gameState,
+                           FixedStepAlpha(fixedStep));
+
+  // print message
+  {
+    struct string_builder *stringBuilder = &context->stringBuilder;
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED("frame done: "));
+    StringBuilderAppendU64(stringBuilder, isFrameDoneEvent);
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED(" time: "));
+    StringBuilderAppendU64(stringBuilder, now);
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED(" elapsed: "));
+    StringBuilderAppendU64(stringBuilder, elapsed);
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED(" steps: "));
+    StringBuilderAppendU64(stringBuilder, stepCount);
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED(" offset: "));
+    StringBuilderAppendF32(stringBuilder, renderState.offset, 2);
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED("\n"));
+    struct string string = StringBuilderFlush(stringBuilder);
+    LogAppend(&context->log, &string);
+  }
+  PROFILER_ZONE_END("update");
+
+  // update frame
+  // previous frame is still being drawn or compositor holds every
+  // buffer, skip this one instead of waiting
+  struct render *render = &context->render;
+  struct swapchain_buffer *buffer = 0;
+  if (!render->isRendering) {
+    RenderScaleUpdate(context);
+    if (context->isResizePending) {
+      enum error_tag errorTag = WindowResize(context);
+      if (errorTag != ERROR_NONE) {
+        context->errorTag = errorTag;
+        context->isWindowClosed = 1;
+        return;
+      }
+    }
+    buffer = SwapchainAcquire(&context->swapchain);
+  }
+  if (buffer) {
+    PROFILER_ZONE_BEGIN("render");
+    context->framePacer.renderStartedAt = now;
+    RenderBegin(render, &context->jobQueue, &context->framebuffer, buffer,
+                renderState.offset);
+    PROFILER_ZONE_END("render");
+  } else {
+    context->frameStats.skippedCount++;
+  }
+
+  context->previousFrameAt = now;
+}
+
+/*
+ * Tells game loop that compositor is ready for next frame.
+ * Called on game loop thread, either while dispatching wayland events or on
+ * headless clock, so flag is enough and no op goes through ring.
+ */
+internal void GameLoopFrameDone(struct linux_context *context) {
+  context->isFrameDonePending = 1;
+}
+
+internal void FramePacerSchedule(struct linux_context *context) {
+  struct frame_pacer *pacer = &context->framePacer;
+  if (pacer->isRenderScheduled || pacer->refreshInterval == 0)
+    return;
+
+  u64 renderAt = FramePacerNextRenderAt(pacer, Now());
+  pacer->renderAt.tv_sec = (s64)(renderAt / 1000000000 /* 1e9 */);
+  pacer->renderAt.tv_nsec = (s64)(renderAt % 1000000000 /* 1e9 */);
+  pacer->isRenderScheduled = 1;
+
+  struct io_uring_sqe *sqe = RingGetSqe(context);
+  io_uring_prep_timeout(sqe, &pacer->renderAt, 0, IORING_TIMEOUT_ABS);
+  io_uring_sqe_set_data(sqe, pacer);
+}
+
+internal void wp_presentation_clock_id(void *data,
+                                       struct wp_presentation *wp_presentation,
+                                       uint32_t clk_id) {
+  struct linux_context *context = data;
+  context->framePacer.clockId = (clockid_t)clk_id;
+}
+
+comptime struct wp_presentation_listener wp_presentation_listener = {
+    .clock_id = wp_presentation_clock_id,
+};
+
+internal void wp_presentation_feedback_sync_output(
+    void *data, struct wp_presentation_feedback *wp_presentation_feedback,
+    struct wl_output *output) {}
+
+internal void wp_presentation_feedback_presented(
+    void *data, struct wp_presentation_feedback *wp_presentation_feedback,
+    uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec, uint32_t refresh,
+    uint32_t seq_hi, uint32_t seq_lo, uint32_t flags) {
+  struct linux_context *context = data;
+  struct frame_pacer *pacer = &context->framePacer;
+  wp_presentation_feedback_destroy(wp_presentation_feedback);
+
+  u64 presentedSeconds = ((u64)tv_sec_hi << 32) | tv_sec_lo;
+  u64 presentedAt = presentedSeconds * 1000000000 /* 1e9 */ + tv_nsec;
+
+  // - convert to CLOCK_MONOTONIC
+  if (pacer->clockId != CLOCK_MONOTONIC) {
+    struct timespec ts;
+    // must not be inside debug_assert, release builds would not read clock
+    s32 error = clock_gettime(pacer->clockId, &ts);
+    debug_assert(error != -1);
+    // unknown clock, time cannot be trusted
+    if (error != 0)
+      return;
+    u64 nowInPresentationClock =
+        ((u64)ts.tv_sec * 1000000000 /* 1e9 */) + (u64)ts.tv_nsec;
+    presentedAt = presentedAt + Now() - nowInPresentationClock;
+  }
+
+  pacer->presentedAt = presentedAt;
+  pacer->refreshInterval = refresh;
+  FramePacerSchedule(context);
+}
+
+internal void wp_presentation_feedback_discarded(
+    void *data, struct wp_presentation_feedback *wp_presentation_feedback) {
+  struct linux_context *context = data;
+  wp_presentation_feedback_destroy(wp_presentation_feedback);
+
+  // frame was replaced or window is hidden, keep predicting from last
+  // presentation until pacer times out
+  if (FramePacerIsActive(&context->framePacer, Now()))
+    FramePacerSchedule(context);
+}
+
+comptime struct wp_presentation_feedback_listener
+    wp_presentation_feedback_listener = {
+        .sync_output = wp_presentation_feedback_sync_output,
+        .presented = wp_presentation_feedback_presented,
+        .discarded = wp_presentation_feedback_discarded,
 };
 
+/*
+ * Queues what pointer did since previous frame as at most one motion and one
+ * scroll event.
+ */
+internal void PointerFrameFlush(struct linux_context *context) {
+  struct pointer_frame *frame = &context->pointerFrame;
+  if (frame->hasMotion) {
+    struct input_queue_event event = {
+        .time = frame->time,
+        .type = INPUT_EVENT_POINTER_MOTION,
+        .x = frame->x,
+        .y = frame->y,
+        .deltaX = frame->deltaX,
+        .deltaY = frame->deltaY,
+    };
+    InputQueuePush(&context->inputQueue, &event);
+  }
+
+  if (frame->hasScroll) {
+    struct input_queue_event event = {
+        .time = frame->time,
+        .type = INPUT_EVENT_POINTER_AXIS,
+        .x = frame->scrollX,
+        .y = frame->scrollY,
+    };
+    InputQueuePush(&context->inputQueue, &event);
+  }
+
+  frame->deltaX = 0;
+  frame->deltaY = 0;
+  frame->scrollX = 0;
+  frame->scrollY = 0;
+  frame->hasMotion = 0;
+  frame->hasScroll = 0;
+}
+
+/*
+ * Without wl_pointer.frame every event is its own frame.
+ */
+internal void PointerFrameEnd(struct linux_context *context) {
+  if (!context->isPointerFrameSupported)
+    PointerFrameFlush(context);
+}
+
 internal void wl_pointer_enter(void *data, struct wl_pointer *wl_pointer,
                                uint32_t serial, struct wl_surface *surface,
-                               wl_fixed_t surface_x, wl_fixed_t surface_y) {}
+                               wl_fixed_t surface_x, wl_fixed_t surface_y) {
+  struct linux_context *context = data;
+  struct pointer_frame *frame = &context->pointerFrame;
+  frame->x = (f32)wl_fixed_to_double(surface_x);
+  frame->y = (f32)wl_fixed_to_double(surface_y);
+  frame->hasMotion = 1;
+
+  // - hide cursor, it would stay still while pointer is locked
+  if (context->zwp_locked_pointer_v1)
+    wl_pointer_set_cursor(wl_pointer, serial, 0, 0, 0);
+
+  PointerFrameEnd(context);
+}
 
 internal void wl_pointer_leave(void *data, struct wl_pointer *wl_pointer,
                                uint32_t serial, struct wl_surface *surface) {}
 
 internal void wl_pointer_motion(void *data, struct wl_pointer *wl_pointer,
                                 uint32_t time, wl_fixed_t surface_x,
-                                wl_fixed_t surface_y) {}
+                                wl_fixed_t surface_y) {
+  struct linux_context *context = data;
+  struct pointer_frame *frame = &context->pointerFrame;
+  frame->time = time;
+  frame->x = (f32)wl_fixed_to_double(surface_x);
+  frame->y = (f32)wl_fixed_to_double(surface_y);
+  frame->hasMotion = 1;
+  PointerFrameEnd(context);
+}
 
 internal void wl_pointer_button(void *data, struct wl_pointer *wl_pointer,
                                 uint32_t serial, uint32_t time, uint32_t button,
-                                uint32_t state) {}
+                                uint32_t state) {
+  struct linux_context *context = data;
+  // motion before button must be seen first
+  PointerFrameFlush(context);
+
+  struct input_queue_event event = {
+      .time = time,
+      .type = INPUT_EVENT_POINTER_BUTTON,
+      .isPressed = state == WL_POINTER_BUTTON_STATE_PRESSED,
+      .code = button,
+  };
+  InputQueuePush(&context->inputQueue, &event);
+}
+
+internal void wl_pointer_axis(void *data, struct wl_pointer *wl_pointer,
+                              uint32_t time, uint32_t axis, wl_fixed_t value) {
+  struct linux_context *context = data;
+  struct pointer_frame *frame = &context->pointerFrame;
+  f32 amount = (f32)wl_fixed_to_double(value);
+  frame->time = time;
+  if (axis == WL_POINTER_AXIS_HORIZONTAL_SCROLL)
+    frame->scrollX += amount;
+  else if (axis == WL_POINTER_AXIS_VERTICAL_SCROLL)
+    frame->scrollY += amount;
+  frame->hasScroll = 1;
+  PointerFrameEnd(context);
+}
+
+internal void wl_pointer_frame(void *data, struct wl_pointer *wl_pointer) {
+  struct linux_context *context = data;
+  PointerFrameFlush(context);
+}
+
+internal void wl_pointer_axis_source(void *data, struct wl_pointer *wl_pointer,
+                                     uint32_t axis_source) {}
+
+internal void wl_pointer_axis_stop(void *data, struct wl_pointer *wl_pointer,
+                                   uint32_t time, uint32_t axis) {}
+
+internal void wl_pointer_axis_discrete(void *data,
+                                       struct wl_pointer *wl_pointer,
+                                       uint32_t axis, int32_t discrete) {}
+
+comptime struct wl_pointer_listener wl_pointer_listener = {
+    .enter = wl_pointer_enter,
+    .leave = wl_pointer_leave,
+    .motion = wl_pointer_motion,
+    .button = wl_pointer_button,
+    .axis = wl_pointer_axis,
+    .frame = wl_pointer_frame,
+    .axis_source = wl_pointer_axis_source,
+    .axis_stop = wl_pointer_axis_stop,
+    .axis_discrete = wl_pointer_axis_discrete,
+};
+
+internal void zwp_relative_pointer_v1_relative_motion(
+    void *data, struct zwp_relative_pointer_v1 *zwp_relative_pointer_v1,
+    uint32_t utime_hi, uint32_t utime_lo, wl_fixed_t dx, wl_fixed_t dy,
+    wl_fixed_t dx_unaccel, wl_fixed_t dy_unaccel) {
+  struct linux_context *context = data;
+  struct pointer_frame *frame = &context->pointerFrame;
+  // microseconds to milliseconds of wl_pointer.motion
+  u64 utime = (u64)utime_hi << 32 | utime_lo;
+  frame->time = (u32)(utime / 1000);
+  frame->deltaX += (f32)wl_fixed_to_double(dx_unaccel);
+  frame->deltaY += (f32)wl_fixed_to_double(dy_unaccel);
+  frame->hasMotion = 1;
+  PointerFrameEnd(context);
+}
+
+comptime struct zwp_relative_pointer_v1_listener
+    zwp_relative_pointer_v1_listener = {
+        .relative_motion = zwp_relative_pointer_v1_relative_motion,
+};
 
-internal void wl_pointer_axis(void *data, struct wl_pointer *wl_pointer,
-                              uint32_t time, uint32_t axis, wl_fixed_t value) {}
+internal void zwp_locked_pointer_v1_locked(
+    void *data, struct zwp_locked_pointer_v1 *zwp_locked_pointer_v1) {
+  struct linux_context *context = data;
+  LogAppend(&context->log, &STRING_FROM_ZERO_TERMINATED("pointer: locked\n"));
+}
 
-internal void wl_pointer_frame(void *data, struct wl_pointer *wl_pointer) {}
+internal void zwp_locked_pointer_v1_unlocked(
+    void *data, struct zwp_locked_pointer_v1 *zwp_locked_pointer_v1) {
+  struct linux_context *context = data;
+  LogAppend(&context->log,
+            &STRING_FROM_ZERO_TERMINATED("pointer: unlocked\n"));
+}
 
-comptime struct wl_pointer_listener wl_pointer_listener = {
-    .enter = wl_pointer_enter,
-    .leave = wl_pointer_leave,
-    .motion = wl_pointer_motion,
-    .button = wl_pointer_button,
-    .axis = wl_pointer_axis,
-    .frame = wl_pointer_frame,
+comptime struct zwp_locked_pointer_v1_listener
+    zwp_locked_pointer_v1_listener = {
+        .locked = zwp_locked_pointer_v1_locked,
+        .unlocked = zwp_locked_pointer_v1_unlocked,
 };
 
 internal void wl_keyboard_keymap(void *data, struct wl_keyboard *wl_keyboard,
@@ -191,40 +1822,51 @@ internal void wl_keyboard_keymap(void *data, struct wl_keyboard *wl_keyboard,
 
   struct linux_context *context = data;
 
-  // TODO: manage memory of xkb_keymap allocations
-  struct memory_temp xkbKeymapMemory = MemoryTempBegin(&context->xkbArena);
-  char *keymapString = (char *)MemoryArenaPush(xkbKeymapMemory.arena, size, 4);
-  {
-    void *mmapResult =
-        mmap(keymapString, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
-    b8 isKeymapReadFromFile = mmapResult != MAP_FAILED;
-    runtime_assert(isKeymapReadFromFile);
+  // - map keymap read only, outside of any arena
+  u8 *keymapString = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (keymapString == MAP_FAILED) {
+    // TODO: handle keymap mmap error
+    return;
+  }
 
-    close(fd);
+  // - reuse keymap compiled from same text
+  struct string keymap = {.value = keymapString, .length = size};
+  u64 hash = StringHash(&keymap);
+  struct xkb_keymap *xkb_keymap =
+      KeymapCacheFind(&context->keymapCache, hash, size);
+  if (xkb_keymap && xkb_keymap == context->xkb_keymap) {
+    // same keymap resent, current state is still valid
+    munmap(keymapString, size);
+    return;
   }
 
-  struct xkb_keymap *xkb_keymap = xkb_keymap_new_from_buffer(
-      context->xkb_context, keymapString, size - 1, XKB_KEYMAP_FORMAT_TEXT_V1,
-      XKB_KEYMAP_COMPILE_NO_FLAGS);
   if (!xkb_keymap) {
-    // TODO: handle xkb_keymap error
-    MemoryTempEnd(&xkbKeymapMemory);
-    return;
+    // size includes null terminator
+    xkb_keymap = xkb_keymap_new_from_buffer(
+        context->xkb_context, (char *)keymapString, size - 1,
+        XKB_KEYMAP_FORMAT_TEXT_V1, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    if (!xkb_keymap) {
+      // TODO: handle xkb_keymap error
+      munmap(keymapString, size);
+      return;
+    }
+    KeymapCacheInsert(&context->keymapCache, hash, size, xkb_keymap);
   }
+  munmap(keymapString, size);
 
   struct xkb_state *xkb_state = xkb_state_new(xkb_keymap);
   if (!xkb_state) {
     // TODO: handle xkb_state error
-    xkb_keymap_unref(xkb_keymap);
-    MemoryTempEnd(&xkbKeymapMemory);
     return;
   }
 
   xkb_keymap_unref(context->xkb_keymap);
   xkb_state_unref(context->xkb_state);
 
-  context->xkb_keymap = xkb_keymap;
+  context->xkb_keymap = xkb_keymap_ref(xkb_keymap);
   context->xkb_state = xkb_state;
+  KeyActionTableBuild(&context->keyActionTable, xkb_state);
 }
 
 internal void wl_keyboard_enter(void *data, struct wl_keyboard *wl_keyboard,
@@ -232,63 +1874,48 @@ internal void wl_keyboard_enter(void *data, struct wl_keyboard *wl_keyboard,
                                 struct wl_array *keys) {}
 
 internal void wl_keyboard_leave(void *data, struct wl_keyboard *wl_keyboard,
-                                uint32_t serial, struct wl_surface *surface) {}
+                                uint32_t serial, struct wl_surface *surface) {
+  struct linux_context *context = data;
+  // release of held key goes to other window
+  if (context->keyRepeat.key != 0)
+    KeyRepeatStop(context);
+}
 
 internal void wl_keyboard_key(void *data, struct wl_keyboard *wl_keyboard,
                               uint32_t serial, uint32_t time, uint32_t key,
                               uint32_t state) {
   struct linux_context *context = data;
-  struct input *keyboardAndMouseInput =
-      InputGetKeyboardAndMouse(context->inputs, ARRAY_SIZE(context->inputs));
 
   // see: WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1
   key += 8;
 
-  xkb_keysym_t keysym = xkb_state_key_get_one_sym(context->xkb_state, key);
-
-  b8 isPressed = state != WL_KEYBOARD_KEY_STATE_RELEASED;
-
-  switch (keysym) {
-  case XKB_KEY_a: {
-    keyboardAndMouseInput->left.isPressed = isPressed;
-  } break;
-
-  case XKB_KEY_d: {
-    keyboardAndMouseInput->right.isPressed = isPressed;
-  } break;
-
-  case XKB_KEY_w: {
-    keyboardAndMouseInput->up.isPressed = isPressed;
-  } break;
-
-  case XKB_KEY_s: {
-    keyboardAndMouseInput->down.isPressed = isPressed;
-  } break;
-
-  case XKB_KEY_q: {
-    keyboardAndMouseInput->down.isPressed = isPressed;
-  } break;
+  struct input_queue_event event = {
+      .time = time,
+      .type = INPUT_EVENT_KEY,
+      .isPressed = state != WL_KEYBOARD_KEY_STATE_RELEASED,
+      .code = key,
+  };
+  struct key_action_table *table = &context->keyActionTable;
+  if (key < KEY_ACTION_TABLE_COUNT) {
+    if (event.isPressed) {
+      // bindings are resolved now, with keymap and modifiers of this moment
+      table->pressedActions[key] = table->actions[key];
+      event.actions = table->pressedActions[key];
+    } else {
+      event.actions = table->pressedActions[key];
+      table->pressedActions[key] = 0;
+    }
+  }
+  InputQueuePush(&context->inputQueue, &event);
+
+  // - repeat held key, modifiers do not repeat
+  if (event.isPressed) {
+    if (context->xkb_keymap &&
+        xkb_keymap_key_repeats(context->xkb_keymap, key))
+      KeyRepeatStart(context, key, event.actions, time);
+  } else if (context->keyRepeat.key == key) {
+    KeyRepeatStop(context);
   }
-
-  struct string_builder *stringBuilder = &context->stringBuilder;
-  StringBuilderAppendString(stringBuilder,
-                            &STRING_FROM_ZERO_TERMINATED("state "));
-  StringBuilderAppendU64(stringBuilder, isPressed);
-  StringBuilderAppendString(stringBuilder,
-                            &STRING_FROM_ZERO_TERMINATED(" up: "));
-  StringBuilderAppendU64(stringBuilder, keyboardAndMouseInput->up.isPressed);
-  StringBuilderAppendString(stringBuilder,
-                            &STRING_FROM_ZERO_TERMINATED(" down: "));
-  StringBuilderAppendU64(stringBuilder, keyboardAndMouseInput->down.isPressed);
-  StringBuilderAppendString(stringBuilder,
-                            &STRING_FROM_ZERO_TERMINATED(" left: "));
-  StringBuilderAppendU64(stringBuilder, keyboardAndMouseInput->left.isPressed);
-  StringBuilderAppendString(stringBuilder,
-                            &STRING_FROM_ZERO_TERMINATED(" right: "));
-  StringBuilderAppendU64(stringBuilder, keyboardAndMouseInput->right.isPressed);
-  StringBuilderAppendString(stringBuilder, &STRING_FROM_ZERO_TERMINATED("\n"));
-  struct string string = StringBuilderFlush(stringBuilder);
-  write(STDOUT_FILENO, string.value, string.length);
 }
 
 internal void wl_keyboard_modifiers(void *data, struct wl_keyboard *wl_keyboard,
@@ -296,13 +1923,27 @@ internal void wl_keyboard_modifiers(void *data, struct wl_keyboard *wl_keyboard,
                                     uint32_t mods_latched, uint32_t mods_locked,
                                     uint32_t group) {
   struct linux_context *context = data;
-  xkb_state_update_mask(context->xkb_state, mods_depressed, mods_latched,
-                        mods_locked, 0, 0, group);
+  if (!context->xkb_state)
+    return;
+
+  enum xkb_state_component changed =
+      xkb_state_update_mask(context->xkb_state, mods_depressed, mods_latched,
+                            mods_locked, 0, 0, group);
+  // most modifier events are repeats of current state
+  if (changed != 0)
+    KeyActionTableBuild(&context->keyActionTable, context->xkb_state);
 }
 
 internal void wl_keyboard_repeat_info(void *data,
                                       struct wl_keyboard *wl_keyboard,
-                                      int32_t rate, int32_t delay) {}
+                                      int32_t rate, int32_t delay) {
+  struct linux_context *context = data;
+  struct key_repeat *repeat = &context->keyRepeat;
+  repeat->rate = rate > 0 ? (u32)rate : 0;
+  repeat->delay = delay > 0 ? (u32)delay : 0;
+  if (repeat->rate == 0 && repeat->key != 0)
+    KeyRepeatStop(context);
+}
 
 comptime struct wl_keyboard_listener wl_keyboard_listener = {
     .keymap = wl_keyboard_keymap,
@@ -313,6 +1954,19 @@ comptime struct wl_keyboard_listener wl_keyboard_listener = {
     .repeat_info = wl_keyboard_repeat_info,
 };
 
+internal void PointerRelease(struct linux_context *context) {
+  if (context->zwp_locked_pointer_v1) {
+    zwp_locked_pointer_v1_destroy(context->zwp_locked_pointer_v1);
+    context->zwp_locked_pointer_v1 = 0;
+  }
+  if (context->zwp_relative_pointer_v1) {
+    zwp_relative_pointer_v1_destroy(context->zwp_relative_pointer_v1);
+    context->zwp_relative_pointer_v1 = 0;
+  }
+  wl_pointer_release(context->wl_pointer);
+  context->wl_pointer = 0;
+}
+
 internal void wl_seat_capabilities(void *data, struct wl_seat *wl_seat,
                                    uint32_t capabilities) {
   struct linux_context *context = data;
@@ -333,9 +1987,31 @@ internal void wl_seat_capabilities(void *data, struct wl_seat *wl_seat,
   if (havePointer && !context->wl_pointer) {
     context->wl_pointer = wl_seat_get_pointer(wl_seat);
     wl_pointer_add_listener(context->wl_pointer, &wl_pointer_listener, context);
+    u32 pointerVersion = wl_pointer_get_version(context->wl_pointer);
+    context->isPointerFrameSupported =
+        pointerVersion >= WL_POINTER_FRAME_SINCE_VERSION;
+
+    if (context->zwp_relative_pointer_manager_v1) {
+      context->zwp_relative_pointer_v1 =
+          zwp_relative_pointer_manager_v1_get_relative_pointer(
+              context->zwp_relative_pointer_manager_v1, context->wl_pointer);
+      zwp_relative_pointer_v1_add_listener(context->zwp_relative_pointer_v1,
+                                           &zwp_relative_pointer_v1_listener,
+                                           context);
+    }
+
+    // compositor keeps lock while window is focused, until it is destroyed
+    if (context->isPointerLockEnabled && context->zwp_pointer_constraints_v1) {
+      context->zwp_locked_pointer_v1 = zwp_pointer_constraints_v1_lock_pointer(
+          context->zwp_pointer_constraints_v1, context->wl_surface,
+          context->wl_pointer, 0,
+          ZWP_POINTER_CONSTRAINTS_V1_LIFETIME_PERSISTENT);
+      zwp_locked_pointer_v1_add_listener(context->zwp_locked_pointer_v1,
+                                         &zwp_locked_pointer_v1_listener,
+                                         context);
+    }
   } else if (!havePointer && context->wl_pointer) {
-    wl_pointer_release(context->wl_pointer);
-    context->wl_pointer = 0;
+    PointerRelease(context);
   }
 }
 
@@ -362,13 +2038,6 @@ wl_surface_frame_done(void *data, struct wl_callback *wl_surface_frame_callback,
                            &wl_surface_frame_listener, context);
   wl_surface_commit(context->wl_surface);
 
-  // // - presentation feedback
-  // struct wp_presentation_feedback *feedback =
-  //     wp_presentation_feedback(context->wp_presentation,
-  //     context->wl_surface);
-  // wp_presentation_feedback_add_listener(
-  //     feedback, &wp_presentation_feedback_listener, context);
-
   {
     globalvar u64 previous = 0;
     u64 now = Now();
@@ -384,16 +2053,12 @@ wl_surface_frame_done(void *data, struct wl_callback *wl_surface_frame_callback,
     StringBuilderAppendString(stringBuilder,
                               &STRING_FROM_ZERO_TERMINATED("\n"));
     struct string string = StringBuilderFlush(stringBuilder);
-    write(STDOUT_FILENO, string.value, string.length);
+    LogAppend(&context->log, &string);
 
     previous = now;
   }
 
-  // notify game loop about frame done event
-  struct io_uring_sqe *sqe = io_uring_get_sqe(context->ring);
-  io_uring_prep_cancel(sqe, context->gameLoopOp, 0);
-  io_uring_sqe_set_data(sqe, 0);
-  io_uring_submit(context->ring);
+  GameLoopFrameDone(context);
 }
 
 comptime struct wl_callback_listener wl_surface_frame_listener = {
@@ -403,7 +2068,24 @@ comptime struct wl_callback_listener wl_surface_frame_listener = {
 internal void xdg_toplevel_configure(void *data,
                                      struct xdg_toplevel *xdg_toplevel,
                                      int32_t width, int32_t height,
-                                     struct wl_array *states) {}
+                                     struct wl_array *states) {
+  struct linux_context *context = data;
+
+  // 0 means we decide, keep current size
+  if (width <= 0 || height <= 0)
+    return;
+
+  u16 windowWidth = width > 0xffff ? 0xffff : (u16)width;
+  u16 windowHeight = height > 0xffff ? 0xffff : (u16)height;
+  if (windowWidth == context->windowWidth &&
+      windowHeight == context->windowHeight)
+    return;
+
+  // buffers are recreated before next frame is drawn
+  context->windowWidth = windowWidth;
+  context->windowHeight = windowHeight;
+  context->isResizePending = 1;
+}
 
 internal void xdg_toplevel_close(void *data,
                                  struct xdg_toplevel *xdg_toplevel) {
@@ -476,13 +2158,35 @@ internal void wl_registry_global(void *data, struct wl_registry *wl_registry,
         wl_registry_bind(wl_registry, name, &xdg_wm_base_interface, version);
   } else if (IsStringEqual(&interfaceString,
                            &STRING_FROM_ZERO_TERMINATED("wl_seat"))) {
+    // listeners handle events up to version 7, newer ones would call null
+    u32 seatVersion = version < 7 ? version : 7;
     context->wl_seat =
-        wl_registry_bind(wl_registry, name, &wl_seat_interface, version);
+        wl_registry_bind(wl_registry, name, &wl_seat_interface, seatVersion);
   } else if (IsStringEqual(
                  &interfaceString,
                  &STRING_FROM_ZERO_TERMINATED("wp_content_type_manager_v1"))) {
     context->wp_content_type_manager_v1 = wl_registry_bind(
         wl_registry, name, &wp_content_type_manager_v1_interface, version);
+  } else if (IsStringEqual(&interfaceString,
+                           &STRING_FROM_ZERO_TERMINATED("wp_presentation"))) {
+    context->wp_presentation =
+        wl_registry_bind(wl_registry, name, &wp_presentation_interface, 1);
+    wp_presentation_add_listener(context->wp_presentation,
+                                 &wp_presentation_listener, context);
+  } else if (IsStringEqual(&interfaceString,
+                           &STRING_FROM_ZERO_TERMINATED("wp_viewporter"))) {
+    context->wp_viewporter =
+        wl_registry_bind(wl_registry, name, &wp_viewporter_interface, 1);
+  } else if (IsStringEqual(&interfaceString,
+                           &STRING_FROM_ZERO_TERMINATED(
+                               "zwp_relative_pointer_manager_v1"))) {
+    context->zwp_relative_pointer_manager_v1 = wl_registry_bind(
+        wl_registry, name, &zwp_relative_pointer_manager_v1_interface, 1);
+  } else if (IsStringEqual(
+                 &interfaceString,
+                 &STRING_FROM_ZERO_TERMINATED("zwp_pointer_constraints_v1"))) {
+    context->zwp_pointer_constraints_v1 = wl_registry_bind(
+        wl_registry, name, &zwp_pointer_constraints_v1_interface, 1);
   }
 }
 
@@ -490,34 +2194,178 @@ comptime struct wl_registry_listener wl_registry_listener = {
     .global = wl_registry_global,
 };
 
+/*
+ * Connects to compositor and waits until window is configured.
+ * Objects created before failure are left in context for cleanup.
+ */
+internal enum error_tag WaylandConnect(struct linux_context *context) {
+  // - get wayland display
+  context->wl_display = wl_display_connect(0);
+  if (!context->wl_display)
+    return ERROR_WL_DISPLAY_CONNECT;
+
+  // - get wayland registry
+  context->wl_registry = wl_display_get_registry(context->wl_display);
+  if (!context->wl_registry)
+    return ERROR_WL_DISPLAY_GET_REGISTRY;
+
+  // - bind to wayland extensions
+  wl_registry_add_listener(context->wl_registry, &wl_registry_listener,
+                           context);
+  wl_display_roundtrip(context->wl_display);
+  if (!context->wl_compositor || !context->xdg_wm_base || !context->wl_shm ||
+      !context->wl_seat)
+    return ERROR_WL_REGISTRY_GLOBAL;
+
+  // - create surface
+  context->wl_surface = wl_compositor_create_surface(context->wl_compositor);
+  if (!context->wl_surface)
+    return ERROR_WL_COMPOSITOR_CREATE_SURFACE;
+
+  // - get inputs
+  wl_seat_add_listener(context->wl_seat, &wl_seat_listener, context);
+
+  // - create window
+  context->xdg_surface =
+      xdg_wm_base_get_xdg_surface(context->xdg_wm_base, context->wl_surface);
+  if (!context->xdg_surface)
+    return ERROR_XDG_WM_BASE_GET_XDG_SURFACE;
+
+  xdg_wm_base_add_listener(context->xdg_wm_base, &xdg_wm_base_listener,
+                           context);
+  xdg_surface_add_listener(context->xdg_surface, &xdg_surface_listener,
+                           context);
+
+  context->xdg_toplevel = xdg_surface_get_toplevel(context->xdg_surface);
+  if (!context->xdg_toplevel)
+    return ERROR_XDG_SURFACE_GET_TOPLEVEL;
+
+  xdg_toplevel_add_listener(context->xdg_toplevel, &xdg_toplevel_listener,
+                            context);
+
+  xdg_toplevel_set_title(context->xdg_toplevel, "$PROJECT_NAME");
+  if (context->wp_content_type_manager_v1) {
+    struct wp_content_type_v1 *wp_content_type_v1 =
+        wp_content_type_manager_v1_get_surface_content_type(
+            context->wp_content_type_manager_v1, context->wl_surface);
+
+    wp_content_type_v1_set_content_type(wp_content_type_v1,
+                                        WP_CONTENT_TYPE_V1_TYPE_GAME);
+  }
+
+  if (context->wp_viewporter)
+    context->wp_viewport =
+        wp_viewporter_get_viewport(context->wp_viewporter, context->wl_surface);
+
+  // - Perform the initial commit and wait for first configure event
+  wl_surface_commit(context->wl_surface);
+  while (wl_display_dispatch(context->wl_display) != -1 &&
+         !context->isXDGSurfaceConfigured) {
+    // intentionally left blank
+  }
+
+  return ERROR_NONE;
+}
+
 int main(int argc, char *argv[]) {
   struct linux_context context = {};
   enum error_tag errorTag = ERROR_NONE;
 
+  // - pick fill kernels for this cpu
+  DrawInit();
+
+  u64 startedAt = Now();
+
+  // arguments
+  // --profile=<path>  write chrome trace of last frames on exit
+  // --huge-pages      back framebuffer with huge pages, faulted in at startup
+  // --evdev-keyboard  also read keyboards from /dev/input, even when window
+  //                   is not focused
+  // --pointer-lock    lock pointer to window and hide cursor
+  // --headless        draw without display, with simulated frame done
+  // --frames=<count>  close after count frames are drawn, reports frame times
+  // --tick-rate=<hz>  simulation steps per second, independent of frame rate
+  // --sqpoll          kernel thread submits ops, loop enters kernel only to
+  //                   wait
+  // --asset=<path>    load image in background, can be given many times
+  u32 evdevKinds = EVDEV_DEVICE_GAMEPAD;
+  struct string assetPaths[ASSET_MAX];
+  u32 assetPathCount = 0;
+  b8 isSqPollEnabled = 0;
+  u64 tickRate = SIMULATION_RATE;
+#if IS_PROFILER_ENABLED
+  struct string profilePath = {};
+#endif
+  for (s32 index = 1; index < argc; index++) {
+    struct string argument = StringFromZeroTerminated((u8 *)argv[index], 4096);
+#if IS_PROFILER_ENABLED
+    struct string profileOption = STRING_FROM_ZERO_TERMINATED("--profile=");
+    if (IsStringStartsWith(&argument, &profileOption)) {
+      profilePath = argument;
+      profilePath.value += profileOption.length;
+      profilePath.length -= profileOption.length;
+    }
+#endif
+    if (IsStringEqual(&argument,
+                      &STRING_FROM_ZERO_TERMINATED("--huge-pages")))
+      context.swapchain.isHugePage = 1;
+    if (IsStringEqual(&argument,
+                      &STRING_FROM_ZERO_TERMINATED("--evdev-keyboard")))
+      evdevKinds |= EVDEV_DEVICE_KEYBOARD;
+    if (IsStringEqual(&argument,
+                      &STRING_FROM_ZERO_TERMINATED("--pointer-lock")))
+      context.isPointerLockEnabled = 1;
+    if (IsStringEqual(&argument, &STRING_FROM_ZERO_TERMINATED("--headless")))
+      context.platform = PLATFORM_HEADLESS;
+    if (IsStringEqual(&argument, &STRING_FROM_ZERO_TERMINATED("--sqpoll")))
+      isSqPollEnabled = 1;
+    struct string assetOption = STRING_FROM_ZERO_TERMINATED("--asset=");
+    if (IsStringStartsWith(&argument, &assetOption) &&
+        assetPathCount < ARRAY_SIZE(assetPaths)) {
+      assetPaths[assetPathCount] = (struct string){
+          .value = argument.value + assetOption.length,
+          .length = argument.length - assetOption.length,
+      };
+      assetPathCount++;
+    }
+    struct string framesOption = STRING_FROM_ZERO_TERMINATED("--frames=");
+    if (IsStringStartsWith(&argument, &framesOption)) {
+      struct string frames = {.value = argument.value + framesOption.length,
+                              .length = argument.length - framesOption.length};
+      ParseU64(&frames, &context.frameLimit);
+    }
+    struct string tickRateOption = STRING_FROM_ZERO_TERMINATED("--tick-rate=");
+    if (IsStringStartsWith(&argument, &tickRateOption)) {
+      struct string rate = {.value = argument.value + tickRateOption.length,
+                            .length = argument.length - tickRateOption.length};
+      if (!ParseU64(&rate, &tickRate) || tickRate == 0 || tickRate > 1000)
+        tickRate = SIMULATION_RATE;
+    }
+  }
+
   // memory
   struct memory_arena *memoryArena = &context.memoryArena;
   {
     u64 MEGABYTES = 1 << 20;
-    // TODO: tweak this after release
-    u64 totalMemoryAllocated = 64 * MEGABYTES;
-
-    // TODO: maybe MAP_UNINITIALIZED?
-    *memoryArena = (struct memory_arena){
-        .total = totalMemoryAllocated,
-        .block = mmap(0, totalMemoryAllocated, PROT_READ | PROT_WRITE,
-                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0),
-    };
-    if (memoryArena->block == MAP_FAILED) {
+    // room for every buffer at largest size, plus huge page alignment of
+    // pool start and end
+    u64 framebufferMemorySize =
+        SWAPCHAIN_BUFFER_COUNT * SWAPCHAIN_WIDTH_MAX * SWAPCHAIN_HEIGHT_MAX *
+            sizeof(u32) +
+        2 * SWAPCHAIN_HUGE_PAGE_SIZE;
+    // only address space is reserved, pages are committed as arenas grow
+    u64 totalMemoryReserved =
+        1024 * MEGABYTES + framebufferMemorySize + ASSET_MEMORY_SIZE;
+    if (!MemoryArenaReserve(memoryArena, totalMemoryReserved, 0)) {
       errorTag = ERROR_MMAP;
       goto exit;
     }
 
-    // TODO: tweak this
-    // 1920x1080x4 = ~7.91m
-    context.framebufferArena = MemoryArenaSub(memoryArena, 8 * MEGABYTES);
-
-    // TODO: tweak this
-    context.xkbArena = MemoryArenaSub(memoryArena, 1 * MEGABYTES);
+    // buffers are allocated when window size is known, see WindowResize()
+    context.framebufferArena =
+        MemoryArenaSub(memoryArena, framebufferMemorySize);
+    AssetLoaderInit(&context.assetStream.loader,
+                    MemoryArenaSub(memoryArena, ASSET_MEMORY_SIZE));
   }
 
   // string builder
@@ -527,176 +2375,183 @@ int main(int argc, char *argv[]) {
   stringBuilder->outBuffer = &stdoutBuffer;
   stringBuilder->stringBuffer = &stringBuffer;
 
+  // log
+  // kernel can refuse to commit pages of arena
+  if (!stdoutBuffer.value || !stringBuffer.value ||
+      !LogInit(&context.log, memoryArena, LOG_BUFFER_SIZE) ||
+      !InputQueueInit(&context.inputQueue, memoryArena,
+                      INPUT_QUEUE_CAPACITY)) {
+    errorTag = ERROR_OUT_OF_MEMORY;
+    goto exit;
+  }
+
   // framebuffer
+  // used until compositor tells window size
   struct framebuffer *framebuffer = &context.framebuffer;
-  struct memory_arena *framebufferArena = &context.framebufferArena;
-  {
-    framebuffer->width = 1920;
-    framebuffer->height = 1080;
-
-    framebuffer->stride = framebuffer->width * sizeof(u32);
-    u64 size = framebuffer->height * framebuffer->stride;
+  context.windowWidth = 1920;
+  context.windowHeight = 1080;
+  context.renderScale = 1.0f;
+  context.keyRepeat.rate = KEY_REPEAT_RATE;
+  context.keyRepeat.delay = KEY_REPEAT_DELAY;
+  for (u32 index = 0; index < ARRAY_SIZE(context.evdevDevices); index++)
+    context.evdevDevices[index] = (struct evdev_device){.fd = -1};
+  if (!FrameStatsInit(&context.frameStats, memoryArena, FRAME_STATS_COUNT)) {
+    errorTag = ERROR_OUT_OF_MEMORY;
+    goto exit;
+  }
+  FixedStepInit(&context.fixedStep, (u32)tickRate, SIMULATION_STEP_MAX);
 
-    // wl_buffer needs to be aligned to pagesize. see: ERROR_MMAP_WL_SHM
-    u64 pagesize = (u64)sysconf(_SC_PAGESIZE);
-    framebuffer->data = MemoryArenaPush(framebufferArena, size, pagesize);
+#if IS_MEMORY_STATS_ENABLED
+  // - dump memory stats on SIGUSR1
+  // must be blocked before workers start, they inherit signal mask
+  s32 memoryStatsFd;
+  {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &mask, 0);
+    memoryStatsFd = signalfd(-1, &mask, SFD_CLOEXEC);
   }
+#endif
 
   // threads
-  /*
   {
-    pthread_t outputThread;
-    if (pthread_create(&outputThread, 0, OutputThreadMain, &context)) {
-      errorTag = ERROR_OUTPUT_PTHREAD_CREATE;
+    s64 processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 workerCount = processorCount < 1    ? 1
+                      : processorCount > 64 ? 64
+                                            : (u32)processorCount;
+
+#if IS_PROFILER_ENABLED
+    // every worker gets its own ring
+    if (!ProfilerInit(&context.profiler, memoryArena, workerCount,
+                      PROFILER_EVENT_COUNT)) {
+      errorTag = ERROR_OUT_OF_MEMORY;
       goto exit;
     }
-    pthread_setname_np(outputThread, "vo");
-  }
-  */
-
-  // - initialize xkb
-  context.xkb_context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
-  if (!context.xkb_context) {
-    errorTag = ERROR_XKB_CONTEXT_NEW;
-    goto exit;
-  }
-
-  // wayland
-  // - get wayland display
-  context.wl_display = wl_display_connect(0);
-  if (!context.wl_display) {
-    errorTag = ERROR_WL_DISPLAY_CONNECT;
-    goto exit;
-  }
-
-  // - get wayland registry
-  context.wl_registry = wl_display_get_registry(context.wl_display);
-  if (!context.wl_registry) {
-    errorTag = ERROR_WL_DISPLAY_GET_REGISTRY;
-    goto wl_exit;
-  }
-
-  // - bind to wayland extensions
-  wl_registry_add_listener(context.wl_registry, &wl_registry_listener,
-                           &context);
-  wl_display_roundtrip(context.wl_display);
-  if (!context.wl_compositor || !context.xdg_wm_base || !context.wl_shm ||
-      !context.wl_seat) {
-    errorTag = ERROR_WL_REGISTRY_GLOBAL;
-    goto wl_exit;
-  }
+#endif
 
-  // - create surface
-  context.wl_surface = wl_compositor_create_surface(context.wl_compositor);
-  if (!context.wl_surface) {
-    errorTag = ERROR_WL_COMPOSITOR_CREATE_SURFACE;
-    goto wl_exit;
+    if (!JobQueueInit(&context.jobQueue, memoryArena, workerCount)) {
+      errorTag = ERROR_JOB_QUEUE_INIT;
+      goto exit;
+    }
   }
 
-  // - get inputs
-  wl_seat_add_listener(context.wl_seat, &wl_seat_listener, &context);
+  // render
+  struct render *render = &context.render;
+  {
+    render->counter.onComplete = RenderDone;
+    render->tileJobMax =
+        RenderTileJobMax(SWAPCHAIN_WIDTH_MAX, SWAPCHAIN_HEIGHT_MAX);
+    render->tileJobs = MemoryArenaPush(
+        memoryArena, sizeof(*render->tileJobs) * render->tileJobMax, 8);
+    if (!render->tileJobs) {
+      errorTag = ERROR_OUT_OF_MEMORY;
+      goto exit;
+    }
 
-  // - create window
-  context.xdg_surface =
-      xdg_wm_base_get_xdg_surface(context.xdg_wm_base, context.wl_surface);
-  if (!context.xdg_surface) {
-    errorTag = ERROR_XDG_WM_BASE_GET_XDG_SURFACE;
-    goto wl_exit;
+    render->doneFd = eventfd(0, EFD_CLOEXEC);
+    if (render->doneFd == -1) {
+      errorTag = ERROR_EVENTFD;
+      goto exit;
+    }
   }
 
-  xdg_wm_base_add_listener(context.xdg_wm_base, &xdg_wm_base_listener,
-                           &context);
-  xdg_surface_add_listener(context.xdg_surface, &xdg_surface_listener,
-                           &context);
-
-  context.xdg_toplevel = xdg_surface_get_toplevel(context.xdg_surface);
-  if (!context.xdg_toplevel) {
-    errorTag = ERROR_XDG_SURFACE_GET_TOPLEVEL;
-    goto wl_exit;
+  // asset stream
+  struct asset_stream *assetStream = &context.assetStream;
+  {
+    assetStream->loader.onComplete = AssetStreamDone;
+    assetStream->doneFd = eventfd(0, EFD_CLOEXEC);
+    if (assetStream->doneFd == -1) {
+      errorTag = ERROR_EVENTFD;
+      goto exit;
+    }
   }
 
-  xdg_toplevel_add_listener(context.xdg_toplevel, &xdg_toplevel_listener,
-                            &context);
-
-  xdg_toplevel_set_title(context.xdg_toplevel, "$PROJECT_NAME");
-  if (context.wp_content_type_manager_v1) {
-    struct wp_content_type_v1 *wp_content_type_v1 =
-        wp_content_type_manager_v1_get_surface_content_type(
-            context.wp_content_type_manager_v1, context.wl_surface);
-
-    wp_content_type_v1_set_content_type(wp_content_type_v1,
-                                        WP_CONTENT_TYPE_V1_TYPE_GAME);
+  // - initialize xkb
+  KeyActionTableSetBindings(&context.keyActionTable, 0, DefaultKeyBindings,
+                            ARRAY_SIZE(DefaultKeyBindings));
+  context.xkb_context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+  if (!context.xkb_context) {
+    errorTag = ERROR_XKB_CONTEXT_NEW;
+    goto exit;
   }
 
-  // - Perform the initial commit and wait for first configure event
-  wl_surface_commit(context.wl_surface);
-  while (wl_display_dispatch(context.wl_display) != -1 &&
-         !context.isXDGSurfaceConfigured) {
-    // intentionally left blank
+  if (context.platform == PLATFORM_WAYLAND) {
+    errorTag = WaylandConnect(&context);
+    if (errorTag != ERROR_NONE)
+      goto wl_exit;
+    EvdevDevicesOpen(&context, evdevKinds);
   }
 
   // - attach framebuffer to window
   {
-    s32 fd = memfd_create("wl_shm", 0);
-    if (fd == -1) {
-      errorTag = ERROR_MEMFD_CREATE_WL_SHM;
-      goto wl_exit;
-    }
-
-    u64 size = context.framebufferArena.used;
-    if (ftruncate(fd, (off_t)size) == -1) {
-      close(fd);
-      errorTag = ERROR_FTRUNCATE_WL_SHM;
-      goto wl_exit;
-    }
-
-    u8 *data = mmap(framebuffer->data, size, PROT_READ | PROT_WRITE,
-                    MAP_SHARED | MAP_FIXED, fd, 0);
-    if (data == MAP_FAILED) {
-      close(fd);
-      errorTag = ERROR_MMAP_WL_SHM;
-      goto wl_exit;
-    }
-
-    struct wl_shm_pool *wl_shm_pool =
-        wl_shm_create_pool(context.wl_shm, fd, (s32)size);
-    if (!wl_shm_pool) {
-      close(fd);
-      errorTag = ERROR_WL_SHM_CREATE_POOL;
-      goto wl_exit;
-    }
-
-    context.wl_buffer = wl_shm_pool_create_buffer(
-        wl_shm_pool, 0, framebuffer->width, framebuffer->height,
-        framebuffer->stride, WL_SHM_FORMAT_XRGB8888);
-    close(fd);
-    wl_shm_pool_destroy(wl_shm_pool);
-    if (!context.wl_buffer) {
-      errorTag = ERROR_WL_SHM_CREATE_POOL;
+    u64 resizeStartedAt = Now();
+    errorTag = WindowResize(&context);
+    if (errorTag != ERROR_NONE)
       goto wl_exit;
-    }
+    u64 resizeDuration = Now() - resizeStartedAt;
 
     // - draw initial frame
     // must be after creating wl_buffer
+    u64 drawStartedAt = Now();
+    struct swapchain_buffer *buffer = SwapchainAcquire(&context.swapchain);
+    framebuffer->data = buffer->data;
     // DrawSolid(framebuffer, 0x3b82f6);
-    DrawCheckerBoard(framebuffer, 0xcbd5e1, 0x0f172a, context.offset);
-    wl_surface_attach(context.wl_surface, context.wl_buffer, 0, 0);
+    DrawCheckerBoard(framebuffer, 0xcbd5e1, 0x0f172a,
+                     context.gameState.offset);
+    u64 drawDuration = Now() - drawStartedAt;
+
+    // - report how long it took to show something, page faults on first
+    // touch of framebuffer land in first frame unless --huge-pages is given
+    StringBuilderAppendString(
+        stringBuilder, &STRING_FROM_ZERO_TERMINATED("startup: "));
+    StringBuilderAppendU64(stringBuilder, Now() - startedAt);
+    StringBuilderAppendString(
+        stringBuilder, &STRING_FROM_ZERO_TERMINATED("ns swapchain: "));
+    StringBuilderAppendU64(stringBuilder, resizeDuration);
+    StringBuilderAppendString(
+        stringBuilder, &STRING_FROM_ZERO_TERMINATED("ns first frame: "));
+    StringBuilderAppendU64(stringBuilder, drawDuration);
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED("ns huge pages: "));
+    StringBuilderAppendString(
+        stringBuilder,
+        context.swapchain.isHugeTlb    ? &STRING_FROM_ZERO_TERMINATED("hugetlb")
+        : context.swapchain.isHugePage ? &STRING_FROM_ZERO_TERMINATED("thp")
+                                       : &STRING_FROM_ZERO_TERMINATED("no"));
+    StringBuilderAppendString(stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED("\n"));
+    struct string string = StringBuilderFlush(stringBuilder);
+    LogAppend(&context.log, &string);
+    if (context.platform == PLATFORM_WAYLAND)
+      wl_surface_attach(context.wl_surface, buffer->wl_buffer, 0, 0);
+    else
+      buffer->isAcquired = 0;
+
+    render->frameIndex = 1;
+    render->previousOffset = context.gameState.offset;
+    render->isSizeChanged = 0;
+    buffer->frameIndex = render->frameIndex;
   }
 
   // - register frame callback
-  {
+  if (context.platform == PLATFORM_WAYLAND) {
     struct wl_callback *wl_surface_frame_callback =
         wl_surface_frame(context.wl_surface);
     wl_callback_add_listener(wl_surface_frame_callback,
                              &wl_surface_frame_listener, &context);
-  }
 
-  // - commit changes
-  wl_surface_commit(context.wl_surface);
+    // - commit changes
+    wl_surface_commit(context.wl_surface);
+  }
 
   // event loop
   struct op {};
 
+  struct op_eventfd {
+    u64 value;
+  };
+
   struct op_timer {
     struct __kernel_timespec ts;
   };
@@ -705,51 +2560,163 @@ int main(int argc, char *argv[]) {
   {
     struct io_uring_params params = {
         .features = IORING_FEAT_SUBMIT_STABLE,
+        // only game loop thread submits, and it runs completion work when
+        // it waits, so kernel does not need to interrupt it
+        .flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN,
     };
-    if (io_uring_queue_init_params(4, &ring, &params) != 0) {
+    if (isSqPollEnabled) {
+      // task run flags are not allowed with submission thread
+      params.flags = IORING_SETUP_SQPOLL | IORING_SETUP_SINGLE_ISSUER;
+      params.sq_thread_idle = RING_SQ_THREAD_IDLE;
+    }
+    s32 error = io_uring_queue_init_params(RING_ENTRY_COUNT, &ring, &params);
+    if (error == -EINVAL || error == -EPERM) {
+      // - kernel is older than 6.0, or does not allow submission thread
+      params = (struct io_uring_params){
+          .features = IORING_FEAT_SUBMIT_STABLE,
+      };
+      error = io_uring_queue_init_params(RING_ENTRY_COUNT, &ring, &params);
+    }
+    if (error != 0) {
       errorTag = ERROR_IO_URING_QUEUE_INIT;
       goto wl_exit;
     }
 
     context.ring = &ring;
+
+    // - pin log buffers, so kernel does not map them on every write
+    struct iovec iovecs[ARRAY_SIZE(context.log.buffers) + 1];
+    u32 logBufferCount = ARRAY_SIZE(context.log.buffers);
+    for (u32 index = 0; index < logBufferCount; index++)
+      iovecs[index] = (struct iovec){.iov_base = context.log.buffers[index],
+                                     .iov_len = context.log.capacity};
+
+    // - pin asset memory too, only when there is something to load
+    // pinning faults in every page and counts against RLIMIT_MEMLOCK
+    struct memory_arena *assetMemory = &assetStream->loader.memory;
+    b8 isAssetBufferWanted = assetPathCount != 0 &&
+                             MemoryArenaCommit(assetMemory, assetMemory->total);
+    iovecs[ASSET_BUFFER_INDEX] = (struct iovec){
+        .iov_base = assetMemory->block, .iov_len = assetMemory->total};
+    if (isAssetBufferWanted &&
+        io_uring_register_buffers(&ring, iovecs, logBufferCount + 1) == 0) {
+      context.isLogBufferRegistered = 1;
+      assetStream->isBufferRegistered = 1;
+    } else {
+      context.isLogBufferRegistered =
+          io_uring_register_buffers(&ring, iovecs, logBufferCount) == 0;
+    }
   }
 
   // - poll on wl_display
   struct op waylandOp = {};
-  {
-    struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+  if (context.platform == PLATFORM_WAYLAND) {
+    struct io_uring_sqe *sqe = RingGetSqe(&context);
     int fd = wl_display_get_fd(context.wl_display);
     io_uring_prep_poll_multishot(sqe, fd, POLLIN);
     io_uring_sqe_set_data(sqe, &waylandOp);
   }
 
+  // - poll on evdev devices
+  for (u32 index = 0; index < ARRAY_SIZE(context.evdevDevices); index++) {
+    struct evdev_device *device = context.evdevDevices + index;
+    if (device->fd != -1)
+      EvdevDevicePoll(&context, device);
+  }
+
   // - game loop op
   struct op_timer gameLoopOp = {};
   {
-    struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
-    gameLoopOp.ts.tv_nsec = 33333333; // 33.333333ms, 1ms = 1e6 ns
+    struct io_uring_sqe *sqe = RingGetSqe(&context);
+    gameLoopOp.ts.tv_nsec = BACKGROUND_FRAME_INTERVAL; // 1ms = 1e6 ns
 
     // infinite timers at every ts
     io_uring_prep_timeout(sqe, &gameLoopOp.ts, 0, IORING_TIMEOUT_MULTISHOT);
     io_uring_sqe_set_data(sqe, &gameLoopOp);
+  }
+
+  // - simulated frame done op
+  // stands in for compositor, every tick is one frame done event
+  struct op_timer headlessClockOp = {};
+  if (context.platform == PLATFORM_HEADLESS) {
+    struct io_uring_sqe *sqe = RingGetSqe(&context);
+    headlessClockOp.ts.tv_nsec = HEADLESS_FRAME_INTERVAL;
+    io_uring_prep_timeout(sqe, &headlessClockOp.ts, 0,
+                          IORING_TIMEOUT_MULTISHOT);
+    io_uring_sqe_set_data(sqe, &headlessClockOp);
+  }
 
-    context.gameLoopOp = &gameLoopOp;
+  // - render done op
+  struct op_eventfd renderDoneOp = {};
+  {
+    struct io_uring_sqe *sqe = RingGetSqe(&context);
+    io_uring_prep_read(sqe, render->doneFd, &renderDoneOp.value,
+                       sizeof(renderDoneOp.value), 0);
+    io_uring_sqe_set_data(sqe, &renderDoneOp);
+  }
+
+  // - asset done op
+  struct op_eventfd assetDoneOp = {};
+  {
+    struct io_uring_sqe *sqe = RingGetSqe(&context);
+    io_uring_prep_read(sqe, assetStream->doneFd, &assetDoneOp.value,
+                       sizeof(assetDoneOp.value), 0);
+    io_uring_sqe_set_data(sqe, &assetDoneOp);
   }
 
-  io_uring_submit(&ring);
+  // - start loading assets
+  for (u32 index = 0; index < assetPathCount; index++)
+    AssetStreamLoad(&context, assetPaths + index);
+
+#if IS_MEMORY_STATS_ENABLED
+  // - memory stats signal op
+  struct op_signal {
+    struct signalfd_siginfo info;
+  } memoryStatsOp = {};
+  if (memoryStatsFd != -1) {
+    struct io_uring_sqe *sqe = RingGetSqe(&context);
+    io_uring_prep_read(sqe, memoryStatsFd, &memoryStatsOp.info,
+                       sizeof(memoryStatsOp.info), 0);
+    io_uring_sqe_set_data(sqe, &memoryStatsOp);
+  }
+#endif
 
   // - wait for events
+  // ops above are submitted together with first wait
   struct io_uring_cqe *cqe;
 
-  u64 previousFrame = Now();
+  context.previousFrameAt = Now();
   while (!context.isWindowClosed) {
-    while (wl_display_prepare_read(context.wl_display) != 0)
-      wl_display_dispatch_pending(context.wl_display);
-    wl_display_flush(context.wl_display);
+    b8 isWayland = context.platform == PLATFORM_WAYLAND;
+    PROFILER_ZONE_BEGIN("dispatch");
+    if (isWayland) {
+      while (wl_display_prepare_read(context.wl_display) != 0)
+        wl_display_dispatch_pending(context.wl_display);
+    }
+    PROFILER_ZONE_END("dispatch");
+
+    // - on frame done events
+    // raised by wl_callback.done in dispatch above, or by headless clock
+    if (context.isFrameDonePending) {
+      context.isFrameDonePending = 0;
+      u64 now = Now();
+      // when compositor reports presentation times, pacer drives frames
+      if (!FramePacerIsActive(&context.framePacer, now))
+        Frame(&context, now, 1);
+      if (context.isWindowClosed) {
+        if (isWayland)
+          wl_display_cancel_read(context.wl_display);
+        break;
+      }
+    }
+
+    if (isWayland)
+      wl_display_flush(context.wl_display);
 
     int io_uring_wait_err;
   wait_cqe:
-    io_uring_wait_err = io_uring_wait_cqe(&ring, &cqe);
+    // - submit every op queued since last wait
+    io_uring_wait_err = RingSubmitAndWait(&context, &cqe);
     if (io_uring_wait_err != 0) {
       io_uring_wait_err *= -1;
       if (io_uring_wait_err == EAGAIN || io_uring_wait_err == EINTR)
@@ -760,7 +2727,7 @@ int main(int argc, char *argv[]) {
     }
 
     void *data = io_uring_cqe_get_data(cqe);
-    if (data != &waylandOp)
+    if (isWayland && data != &waylandOp)
       wl_display_cancel_read(context.wl_display);
 
     // - on wayland events
@@ -778,73 +2745,257 @@ int main(int argc, char *argv[]) {
        * Games do not stop sending update events when app becomes invisible.
        * (e.g. music plaing in background, physics simulation goes berserk when
        * delta time is huge) I solve this by sleeping with intervals of 33.33ms
-       * when app is in background and using frame done callback when it is in
-       * foreground.
+       * when app is in background and using frame done callback or
+       * presentation feedback when it is in foreground.
+       * Simulation itself runs in fixed steps, so huge delta time only means
+       * more steps, up to SIMULATION_STEP_MAX.
+       * Frame done events do not touch this timer, see GameLoopFrameDone().
        */
-      b8 isFrameDoneEvent = cqe->res == -ECANCELED;
-
       u64 now = Now();
-      u64 elapsed = now - previousFrame;
-
-      u64 targetPerFrameInNanoseconds = 33000000 /* 33.333333ms */;
-      if (elapsed >= targetPerFrameInNanoseconds) {
-        f32 deltaTime = (f32)elapsed / 1e9f;
-        f32 speed = 5.0f;
-        context.offset += deltaTime * speed;
-
-        // print message
-        {
-          StringBuilderAppendString(
-              stringBuilder, &STRING_FROM_ZERO_TERMINATED("frame done: "));
-          StringBuilderAppendU64(stringBuilder, isFrameDoneEvent);
-          StringBuilderAppendString(stringBuilder,
-                                    &STRING_FROM_ZERO_TERMINATED(" time: "));
-          StringBuilderAppendU64(stringBuilder, now);
-          StringBuilderAppendString(stringBuilder,
-                                    &STRING_FROM_ZERO_TERMINATED(" elapsed: "));
-          StringBuilderAppendU64(stringBuilder, elapsed);
-          StringBuilderAppendString(stringBuilder,
-                                    &STRING_FROM_ZERO_TERMINATED(" offset: "));
-          StringBuilderAppendF32(stringBuilder, context.offset, 2);
-          StringBuilderAppendString(stringBuilder,
-                                    &STRING_FROM_ZERO_TERMINATED("\n"));
-          struct string string = StringBuilderFlush(stringBuilder);
-          write(STDOUT_FILENO, string.value, string.length);
-        }
+      u64 elapsed = now - context.previousFrameAt;
 
-        // update frame
-        DrawCheckerBoard(framebuffer, 0xcbd5e1, 0x0f172a, context.offset);
+      // when compositor reports presentation times, pacer drives frames
+      b8 isPacerActive = FramePacerIsActive(&context.framePacer, now);
+      b8 isBackgroundTick = elapsed >= BACKGROUND_FRAME_INTERVAL;
+      if (!isPacerActive && isBackgroundTick)
+        Frame(&context, now, 0);
 
-        previousFrame = now;
+      if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        // - rearm timer, kernel ended multishot
+        struct io_uring_sqe *sqe = RingGetSqe(&context);
+        io_uring_prep_timeout(sqe, &gameLoopOp.ts, 0, IORING_TIMEOUT_MULTISHOT);
+        io_uring_sqe_set_data(sqe, &gameLoopOp);
       }
+    }
 
-      if (isFrameDoneEvent) {
-        // swap buffers when frame done
-        wl_surface_attach(context.wl_surface, context.wl_buffer, 0, 0);
-        wl_surface_damage_buffer(context.wl_surface, 0, 0, INT32_MAX,
-                                 INT32_MAX);
-        wl_surface_commit(context.wl_surface);
+    // - on evdev events
+    else if (EvdevDeviceFromData(&context, data)) {
+      struct evdev_device *device = EvdevDeviceFromData(&context, data);
+      int revents = cqe->res;
+      b8 isDeviceAlive = revents >= 0 && !(revents & (POLLHUP | POLLERR));
+      if (isDeviceAlive && (revents & POLLIN)) {
+        struct input *input =
+            InputGetEvdev(context.inputs, ARRAY_SIZE(context.inputs));
+        isDeviceAlive = EvdevDeviceRead(device, input);
+      }
 
-        // - rearm timer
-        struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
-        io_uring_prep_timeout(sqe, &gameLoopOp.ts, 0, IORING_TIMEOUT_MULTISHOT);
-        io_uring_sqe_set_data(sqe, &gameLoopOp);
-        io_uring_submit(&ring);
+      if (!isDeviceAlive) {
+        // - unplugged
+        if (cqe->flags & IORING_CQE_F_MORE) {
+          struct io_uring_sqe *sqe = RingGetSqe(&context);
+          io_uring_prep_poll_remove(sqe, (u64)device);
+          // result of remove itself is not needed
+          io_uring_sqe_set_data(sqe, 0);
+        }
+        EvdevDeviceClose(device);
+        LogAppend(&context.log,
+                  &STRING_FROM_ZERO_TERMINATED("evdev: device removed\n"));
+      } else if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        // - rearm poll, kernel ended multishot
+        EvdevDevicePoll(&context, device);
+      }
+    }
+
+    // - on asset file events
+    else if (AssetReadFromData(&context, data)) {
+      AssetReadStep(&context, AssetReadFromData(&context, data), cqe->res);
+    }
+
+    // - on asset done events
+    else if (data == &assetDoneOp) {
+      AssetStreamComplete(&context);
+
+      // - rearm read
+      struct io_uring_sqe *sqe = RingGetSqe(&context);
+      io_uring_prep_read(sqe, assetStream->doneFd, &assetDoneOp.value,
+                         sizeof(assetDoneOp.value), 0);
+      io_uring_sqe_set_data(sqe, &assetDoneOp);
+    }
+
+    // - on simulated frame done events
+    else if (data == &headlessClockOp) {
+      GameLoopFrameDone(&context);
+    }
+
+    // - on key repeat events
+    else if (data == &context.keyRepeat) {
+      KeyRepeatTimeout(&context, Now());
+    }
+
+    // - on log write events
+    else if (data == &context.log) {
+      struct string pending = LogWriteDone(&context.log, cqe->res);
+      if (pending.length != 0)
+        LogSubmit(&context, pending);
+    }
+
+#if IS_MEMORY_STATS_ENABLED
+    // - on memory stats signal
+    else if (data == &memoryStatsOp) {
+      if (cqe->res == sizeof(memoryStatsOp.info))
+        MemoryStatsLog(&context);
+
+      // - rearm read
+      struct io_uring_sqe *sqe = RingGetSqe(&context);
+      io_uring_prep_read(sqe, memoryStatsFd, &memoryStatsOp.info,
+                         sizeof(memoryStatsOp.info), 0);
+      io_uring_sqe_set_data(sqe, &memoryStatsOp);
+    }
+#endif
+
+    // - on paced render events
+    else if (data == &context.framePacer) {
+      context.framePacer.isRenderScheduled = 0;
+      Frame(&context, Now(), 0);
+      // - every buffer is held by compositor, nothing is committed so no
+      // feedback comes to schedule next render, try again at next vblank
+      if (!render->isRendering)
+        FramePacerSchedule(&context);
+    }
+
+    // - on render done events
+    else if (data == &renderDoneOp) {
+      PROFILER_ZONE_BEGIN("commit");
+      render->isRendering = 0;
+      u64 now = Now();
+      FramePacerRecordRender(&context.framePacer, now);
+      FrameStatsRecord(&context.frameStats,
+                       now - context.framePacer.renderStartedAt);
+      if (context.frameLimit != 0 &&
+          context.frameStats.count >= context.frameLimit)
+        context.isWindowClosed = 1;
+
+      if (isWayland) {
+        // swap buffers when all tiles are drawn
+        wl_surface_attach(context.wl_surface, render->buffer->wl_buffer, 0,
+                          0);
+
+        // compositor has previous frame, tell only what changed since
+        struct damage *frameDamage = RenderGetFrameDamage(render);
+        for (u32 index = 0; index < frameDamage->count; index++) {
+          struct rect rect = frameDamage->rects[index];
+          wl_surface_damage_buffer(context.wl_surface, rect.x, rect.y,
+                                   rect.width, rect.height);
+        }
+
+        if (context.wp_presentation) {
+          struct wp_presentation_feedback *feedback =
+              wp_presentation_feedback(context.wp_presentation,
+                                       context.wl_surface);
+          wp_presentation_feedback_add_listener(
+              feedback, &wp_presentation_feedback_listener, &context);
+        }
+        wl_surface_commit(context.wl_surface);
+      } else {
+        // nobody reads buffer, it can be drawn again
+        render->buffer->isAcquired = 0;
       }
+
+      // - rearm read
+      struct io_uring_sqe *sqe = RingGetSqe(&context);
+      io_uring_prep_read(sqe, render->doneFd, &renderDoneOp.value,
+                         sizeof(renderDoneOp.value), 0);
+      io_uring_sqe_set_data(sqe, &renderDoneOp);
+      PROFILER_ZONE_END("commit");
     }
 
     io_uring_cqe_seen(&ring, cqe);
+
+    // - write messages of this iteration
+    struct string pending = LogSwap(&context.log);
+    if (pending.length != 0)
+      LogSubmit(&context, pending);
+  }
+
+  FrameStatsLog(&context);
+#if IS_MEMORY_STATS_ENABLED
+  MemoryStatsLog(&context);
+  if (memoryStatsFd != -1)
+    close(memoryStatsFd);
+#endif
+
+  // - flush log
+  // wait for write in flight, then write rest synchronously
+  while (context.log.isWriting && RingSubmitAndWait(&context, &cqe) == 0) {
+    if (io_uring_cqe_get_data(cqe) == &context.log) {
+      struct string pending = LogWriteDone(&context.log, cqe->res);
+      if (pending.length != 0)
+        LogSubmit(&context, pending);
+    }
+    io_uring_cqe_seen(&ring, cqe);
+  }
+  if (!context.log.isWriting) {
+    struct string pending = LogSwap(&context.log);
+    while (pending.length != 0) {
+      ssize_t written = write(STDOUT_FILENO, pending.value, pending.length);
+      pending = LogWriteDone(&context.log, written < 0 ? -errno : written);
+    }
   }
 
   io_uring_queue_exit(&ring);
+  for (u32 index = 0; index < ARRAY_SIZE(context.evdevDevices); index++) {
+    struct evdev_device *device = context.evdevDevices + index;
+    if (device->fd != -1)
+      EvdevDeviceClose(device);
+  }
+  for (u32 index = 0; index < assetStream->loader.assetCount; index++) {
+    struct asset_read *read = assetStream->reads + index;
+    if (read->fd != -1)
+      close(read->fd);
+  }
+  // decoders write into asset memory, let them finish
+  JobCounterWait(&context.jobQueue, &assetStream->loader.decodeCounter);
+  JobQueueDestroy(&context.jobQueue);
+  MemoryScratchRelease();
 
-  xdg_toplevel_destroy(context.xdg_toplevel);
-  xdg_surface_destroy(context.xdg_surface);
-  wl_surface_destroy(context.wl_surface);
-  wl_buffer_destroy(context.wl_buffer);
+#if IS_PROFILER_ENABLED
+  // - export last frames of every thread
+  {
+    // argv strings are zero terminated
+    s32 fd = profilePath.length == 0
+                 ? -1
+                 : open((char *)profilePath.value,
+                        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd != -1) {
+      ProfilerExportChromeTrace(&context.profiler, stringBuilder, fd);
+      close(fd);
+    }
+  }
+#endif
+
+  if (context.platform == PLATFORM_WAYLAND) {
+    xdg_toplevel_destroy(context.xdg_toplevel);
+    xdg_surface_destroy(context.xdg_surface);
+    wl_surface_destroy(context.wl_surface);
+    for (u32 index = 0; index < ARRAY_SIZE(context.swapchain.buffers);
+         index++) {
+      struct swapchain_buffer *buffer = context.swapchain.buffers + index;
+      if (buffer->wl_buffer)
+        wl_buffer_destroy(buffer->wl_buffer);
+    }
+    if (context.wp_viewport)
+      wp_viewport_destroy(context.wp_viewport);
+    if (context.wp_viewporter)
+      wp_viewporter_destroy(context.wp_viewporter);
+    if (context.wl_pointer)
+      PointerRelease(&context);
+    if (context.zwp_pointer_constraints_v1)
+      zwp_pointer_constraints_v1_destroy(context.zwp_pointer_constraints_v1);
+    if (context.zwp_relative_pointer_manager_v1)
+      zwp_relative_pointer_manager_v1_destroy(
+          context.zwp_relative_pointer_manager_v1);
+    if (context.wp_presentation)
+      wp_presentation_destroy(context.wp_presentation);
+  }
+  xkb_state_unref(context.xkb_state);
+  xkb_keymap_unref(context.xkb_keymap);
+  KeymapCacheRelease(&context.keymapCache);
+  if (context.errorTag != ERROR_NONE)
+    errorTag = context.errorTag;
 
 wl_exit:
-  wl_display_disconnect(context.wl_display);
+  if (context.wl_display)
+    wl_display_disconnect(context.wl_display);
 
 exit:
   return (int)errorTag;
@@ -0,0 +1,189 @@
+#include "asset.h"
+
+// TODO: Show error pretty error message when a test fails
+enum asset_test_error {
+  ASSET_TEST_ERROR_NONE = 0,
+  ASSET_TEST_ERROR_PARSE_HEADER_EXPECTED_SIZE,
+  ASSET_TEST_ERROR_PARSE_HEADER_EXPECTED_FAIL,
+  ASSET_TEST_ERROR_PUSH_FILE_EXPECTED_FAIL_WHEN_FULL,
+  ASSET_TEST_ERROR_DECODE_EXPECTED_PIXELS,
+  ASSET_TEST_ERROR_DECODE_EXPECTED_FAIL_WHEN_TRUNCATED,
+  ASSET_TEST_ERROR_DECODE_EXPECTED_EVERY_ASSET_COMPLETED,
+  ASSET_TEST_ERROR_RESET_EXPECTED_EMPTY,
+
+  // src: https://mesonbuild.com/Unit-tests.html#skipped-tests-and-hard-errors
+  // For the default exitcode testing protocol, the GNU standard approach in
+  // this case is to exit the program with error code 77. Meson will detect this
+  // and report these tests as skipped rather than failed. This behavior was
+  // added in version 0.37.0.
+  MESON_TEST_SKIP = 77,
+  // In addition, sometimes a test fails set up so that it should fail even if
+  // it is marked as an expected failure. The GNU standard approach in this case
+  // is to exit the program with error code 99. Again, Meson will detect this
+  // and report these tests as ERROR, ignoring the setting of should_fail. This
+  // behavior was added in version 0.50.0.
+  MESON_TEST_FAILED_TO_SET_UP = 99,
+};
+
+// 2x1 image, red and green
+static u8 Image[] = "P6\n# comment\n2 1\n255\n\xff\x00\x00\x00\xff\x00";
+#define IMAGE_SIZE (sizeof(Image) - 1)
+
+static u32 CompleteCount;
+static void OnComplete(struct asset_loader *loader) {
+  __atomic_add_fetch(&CompleteCount, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Pretends to be platform layer that read file.
+ */
+static struct asset *Load(struct asset_loader *loader, struct job_queue *queue,
+                          u8 *file, u64 fileSize) {
+  struct asset *asset =
+      AssetLoaderAdd(loader, &STRING_FROM_ZERO_TERMINATED("image.ppm"));
+  if (!asset || !AssetLoaderPushFile(loader, asset, fileSize))
+    return 0;
+  memcpy(asset->file, file, fileSize);
+  AssetLoaderDecode(loader, asset, queue);
+  return asset;
+}
+
+int main(void) {
+  enum asset_test_error errorCode = ASSET_TEST_ERROR_NONE;
+  struct memory_arena memory;
+
+  {
+    u64 KILOBYTES = 1 << 10;
+    u64 total = 256 * KILOBYTES;
+    memory = (struct memory_arena){.block = alloca(total), .total = total};
+    if (memory.block == 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+    bzero(memory.block, memory.total);
+  }
+
+  // AssetImageParseHeader(u8 *file, u64 fileSize, struct image *image,
+  //                       u64 *pixelOffset)
+  {
+    struct image image = {};
+    u64 pixelOffset = 0;
+    if (!AssetImageParseHeader(Image, IMAGE_SIZE, &image, &pixelOffset) ||
+        image.width != 2 || image.height != 1 ||
+        pixelOffset != IMAGE_SIZE - 6) {
+      errorCode = ASSET_TEST_ERROR_PARSE_HEADER_EXPECTED_SIZE;
+      goto end;
+    }
+
+    struct string invalids[] = {
+        // ascii pixels
+        STRING_FROM_ZERO_TERMINATED("P3\n1 1\n255\n0 0 0"),
+        // 16 bit channels
+        STRING_FROM_ZERO_TERMINATED("P6\n1 1\n65535\n\0\0\0\0\0\0"),
+        // pixels missing
+        STRING_FROM_ZERO_TERMINATED("P6\n2 2\n255\n\0\0\0"),
+        STRING_FROM_ZERO_TERMINATED("P6\n0 1\n255\n"),
+        STRING_FROM_ZERO_TERMINATED("P6\n1"),
+        STRING_FROM_ZERO_TERMINATED(""),
+    };
+    for (u32 index = 0; index < sizeof(invalids) / sizeof(*invalids);
+         index++) {
+      struct string *invalid = invalids + index;
+      if (AssetImageParseHeader(invalid->value, invalid->length, &image,
+                                &pixelOffset)) {
+        errorCode = ASSET_TEST_ERROR_PARSE_HEADER_EXPECTED_FAIL;
+        goto end;
+      }
+    }
+  }
+
+  // AssetLoaderDecode(struct asset_loader *loader, struct asset *asset,
+  //                   struct job_queue *queue) with 1 worker
+  {
+    struct memory_temp tempMemory = MemoryTempBegin(&memory);
+    struct job_queue queue;
+    if (!JobQueueInit(&queue, &memory, 1)) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+
+    struct asset_loader loader = {.onComplete = OnComplete};
+    AssetLoaderInit(&loader, MemoryArenaSub(&memory, 4096));
+    CompleteCount = 0;
+
+    struct asset *asset = Load(&loader, &queue, Image, IMAGE_SIZE);
+    struct asset *completed = AssetLoaderTakeCompleted(&loader);
+    if (!asset || completed != asset || asset->next != 0 ||
+        asset->state != ASSET_STATE_READY || CompleteCount != 1 ||
+        asset->image.pixels[0] != 0xff0000 ||
+        asset->image.pixels[1] != 0x00ff00) {
+      errorCode = ASSET_TEST_ERROR_DECODE_EXPECTED_PIXELS;
+      goto queue_end;
+    }
+
+    asset = Load(&loader, &queue, Image, IMAGE_SIZE - 1);
+    completed = AssetLoaderTakeCompleted(&loader);
+    if (!asset || completed != asset || asset->state != ASSET_STATE_FAILED ||
+        CompleteCount != 2) {
+      errorCode = ASSET_TEST_ERROR_DECODE_EXPECTED_FAIL_WHEN_TRUNCATED;
+      goto queue_end;
+    }
+
+    asset = AssetLoaderAdd(&loader, &STRING_FROM_ZERO_TERMINATED("big.ppm"));
+    if (!asset || AssetLoaderPushFile(&loader, asset, 4096)) {
+      errorCode = ASSET_TEST_ERROR_PUSH_FILE_EXPECTED_FAIL_WHEN_FULL;
+      goto queue_end;
+    }
+
+    AssetLoaderReset(&loader);
+    if (loader.assetCount != 0 || loader.memory.used != 0) {
+      errorCode = ASSET_TEST_ERROR_RESET_EXPECTED_EMPTY;
+      goto queue_end;
+    }
+
+  queue_end:
+    JobQueueDestroy(&queue);
+    MemoryTempEnd(&tempMemory);
+    if (errorCode != ASSET_TEST_ERROR_NONE)
+      goto end;
+  }
+
+  // AssetLoaderTakeCompleted(struct asset_loader *loader) with 4 workers
+  {
+    struct memory_temp tempMemory = MemoryTempBegin(&memory);
+    struct job_queue queue;
+    if (!JobQueueInit(&queue, &memory, 4)) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+
+    struct asset_loader loader = {.onComplete = OnComplete};
+    AssetLoaderInit(&loader, MemoryArenaSub(&memory, 64 * 1024));
+    CompleteCount = 0;
+
+    // - completion list is pushed from many workers at once
+    for (u32 index = 0; index < ASSET_MAX; index++) {
+      if (!Load(&loader, &queue, Image, IMAGE_SIZE)) {
+        errorCode = MESON_TEST_FAILED_TO_SET_UP;
+        break;
+      }
+    }
+    JobCounterWait(&queue, &loader.decodeCounter);
+
+    u32 readyCount = 0;
+    struct asset *asset = AssetLoaderTakeCompleted(&loader);
+    for (; asset; asset = asset->next)
+      readyCount += asset->state == ASSET_STATE_READY;
+    if (errorCode == ASSET_TEST_ERROR_NONE &&
+        (readyCount != ASSET_MAX || CompleteCount != ASSET_MAX))
+      errorCode = ASSET_TEST_ERROR_DECODE_EXPECTED_EVERY_ASSET_COMPLETED;
+
+    JobQueueDestroy(&queue);
+    MemoryTempEnd(&tempMemory);
+    if (errorCode != ASSET_TEST_ERROR_NONE)
+      goto end;
+  }
+
+end:
+  return (int)errorCode;
+}
@@ -10,6 +10,11 @@ RunTest() {
 
   "$executable"
   statusCode=$?
+  # 77 means test cannot run here, e.g. device is missing
+  if [ $statusCode -eq 77 ]; then
+    echo "$(basename "$executable") skipped."
+    return
+  fi
   if [ $statusCode -ne 0 ]; then
     echo "$failMessage code $statusCode"
     exit $statusCode
@@ -22,7 +27,7 @@ RunTest() {
 inc="-I$ProjectRoot/include"
 src="$ProjectRoot/test/memory_test.c"
 output="$OutputDir/$(BasenameWithoutExtension "$src")"
-lib="$LIB_M"
+lib="$LIB_M $LIB_PTHREAD"
 "$cc" $cflags $ldflags $inc -o "$output" $src $lib
 RunTest "$output" "TEST memory failed."
 
@@ -33,3 +38,88 @@ output="$OutputDir/$(BasenameWithoutExtension "$src")"
 lib="$LIB_M"
 "$cc" $cflags $ldflags $inc -o "$output" $src $lib
 RunTest "$output" "TEST text failed."
+
+### draw_test
+inc="-I$ProjectRoot/include"
+src="$ProjectRoot/test/draw_test.c"
+output="$OutputDir/$(BasenameWithoutExtension "$src")"
+lib="$LIB_M"
+"$cc" $cflags $ldflags $inc -o "$output" $src $lib
+RunTest "$output" "TEST draw failed."
+
+### job_test
+inc="-I$ProjectRoot/include"
+src="$ProjectRoot/test/job_test.c"
+output="$OutputDir/$(BasenameWithoutExtension "$src")"
+lib="$LIB_M $LIB_PTHREAD"
+"$cc" $cflags $ldflags $inc -o "$output" $src $lib
+RunTest "$output" "TEST job failed."
+
+### profiler_test
+inc="-I$ProjectRoot/include"
+src="$ProjectRoot/test/profiler_test.c"
+output="$OutputDir/$(BasenameWithoutExtension "$src")"
+lib="$LIB_M $LIB_PTHREAD"
+"$cc" $cflags $ldflags $inc -o "$output" $src $lib
+RunTest "$output" "TEST profiler failed."
+
+### log_test
+inc="-I$ProjectRoot/include"
+src="$ProjectRoot/test/log_test.c"
+output="$OutputDir/$(BasenameWithoutExtension "$src")"
+lib="$LIB_M"
+"$cc" $cflags $ldflags $inc -o "$output" $src $lib
+RunTest "$output" "TEST log failed."
+
+### string_builder_test
+inc="-I$ProjectRoot/include"
+src="$ProjectRoot/test/string_builder_test.c"
+output="$OutputDir/$(BasenameWithoutExtension "$src")"
+lib="$LIB_M"
+"$cc" $cflags $ldflags $inc -o "$output" $src $lib
+RunTest "$output" "TEST string builder failed."
+
+### input_test
+inc="-I$ProjectRoot/include"
+src="$ProjectRoot/test/input_test.c"
+output="$OutputDir/$(BasenameWithoutExtension "$src")"
+lib="$LIB_M $LIB_PTHREAD"
+"$cc" $cflags $ldflags $inc -o "$output" $src $lib
+RunTest "$output" "TEST input failed."
+
+### frame_stats_test
+inc="-I$ProjectRoot/include"
+src="$ProjectRoot/test/frame_stats_test.c"
+output="$OutputDir/$(BasenameWithoutExtension "$src")"
+lib="$LIB_M"
+"$cc" $cflags $ldflags $inc -o "$output" $src $lib
+RunTest "$output" "TEST frame stats failed."
+
+### fixed_step_test
+inc="-I$ProjectRoot/include"
+src="$ProjectRoot/test/fixed_step_test.c"
+output="$OutputDir/$(BasenameWithoutExtension "$src")"
+lib="$LIB_M"
+"$cc" $cflags $ldflags $inc -o "$output" $src $lib
+RunTest "$output" "TEST fixed step failed."
+
+### asset_test
+inc="-I$ProjectRoot/include"
+src="$ProjectRoot/test/asset_test.c"
+output="$OutputDir/$(BasenameWithoutExtension "$src")"
+lib="$LIB_M $LIB_PTHREAD"
+"$cc" $cflags $ldflags $inc -o "$output" $src $lib
+RunTest "$output" "TEST asset failed."
+
+### evdev_test
+# tests can be built without main program
+if [ -z "$LIB_LIBEVDEV" ]; then
+  INC_LIBEVDEV=$(pkg-config --cflags libevdev)
+  LIB_LIBEVDEV=$(pkg-config --libs libevdev)
+fi
+inc="-I$ProjectRoot/include $INC_LIBEVDEV"
+src="$ProjectRoot/test/evdev_test.c"
+output="$OutputDir/$(BasenameWithoutExtension "$src")"
+lib="$LIB_M $LIB_LIBEVDEV"
+"$cc" $cflags $ldflags $inc -o "$output" $src $lib
+RunTest "$output" "TEST evdev failed."
@@ -0,0 +1,352 @@
+#include <time.h>
+#include <unistd.h>
+
+#include "StringBuilder.h"
+#include "draw.h"
+
+// TODO: Show error pretty error message when a test fails
+enum draw_test_error {
+  DRAW_TEST_ERROR_NONE = 0,
+  DRAW_TEST_ERROR_DRAW_SOLID_SCALAR,
+  DRAW_TEST_ERROR_DRAW_SOLID_SSE2,
+  DRAW_TEST_ERROR_DRAW_SOLID_AVX2,
+  DRAW_TEST_ERROR_DRAW_SOLID_PADDED_STRIDE,
+  DRAW_TEST_ERROR_DRAW_CHECKERBOARD_SCALAR,
+  DRAW_TEST_ERROR_DRAW_CHECKERBOARD_SSE2,
+  DRAW_TEST_ERROR_DRAW_CHECKERBOARD_AVX2,
+  DRAW_TEST_ERROR_DRAW_CHECKERBOARD_OFFSET,
+  DRAW_TEST_ERROR_DRAW_CHECKERBOARD_PADDED_STRIDE,
+  DRAW_TEST_ERROR_DRAW_CHECKERBOARD_RECT_TILED,
+  DRAW_TEST_ERROR_DAMAGE_ADD_EXPECTED_MERGE_TOUCHING,
+  DRAW_TEST_ERROR_DAMAGE_ADD_EXPECTED_KEEP_DISJOINT,
+  DRAW_TEST_ERROR_DAMAGE_ADD_EXPECTED_BOUNDED,
+  DRAW_TEST_ERROR_DRAW_CHECKERBOARD_DAMAGE_EXPECTED_NONE,
+  DRAW_TEST_ERROR_DRAW_CHECKERBOARD_DAMAGE_EXPECTED_STRIPS,
+  DRAW_TEST_ERROR_DRAW_CHECKERBOARD_DAMAGE_REPAINT,
+
+  // src: https://mesonbuild.com/Unit-tests.html#skipped-tests-and-hard-errors
+  // For the default exitcode testing protocol, the GNU standard approach in
+  // this case is to exit the program with error code 77. Meson will detect this
+  // and report these tests as skipped rather than failed. This behavior was
+  // added in version 0.37.0.
+  MESON_TEST_SKIP = 77,
+  // In addition, sometimes a test fails set up so that it should fail even if
+  // it is marked as an expected failure. The GNU standard approach in this case
+  // is to exit the program with error code 99. Again, Meson will detect this
+  // and report these tests as ERROR, ignoring the setting of should_fail. This
+  // behavior was added in version 0.50.0.
+  MESON_TEST_FAILED_TO_SET_UP = 99,
+};
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define LIGHT_COLOR 0xcbd5e1
+#define DARK_COLOR 0x0f172a
+
+static u32 pixels[WIDTH * HEIGHT] __attribute__((aligned(4096)));
+
+static u64 Now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((u64)ts.tv_sec * 1000000000 /* 1e9 */) + (u64)ts.tv_nsec;
+}
+
+static b8 IsSolid(struct framebuffer *framebuffer, u32 color) {
+  u8 *row = framebuffer->data;
+  for (u16 y = 0; y < framebuffer->height; y++) {
+    u32 *pixel = (u32 *)row;
+    for (u16 x = 0; x < framebuffer->width; x++) {
+      if (pixel[x] != color)
+        return 0;
+    }
+    row += framebuffer->stride;
+  }
+  return 1;
+}
+
+static b8 IsCheckerBoard(struct framebuffer *framebuffer, f32 offset) {
+  u32 checkerSizeInPixels = 350;
+  u32 xOffset = (u32)(offset * 10.0f);
+  u8 *row = framebuffer->data;
+  for (u32 y = 0; y < framebuffer->height; y++) {
+    u32 *pixel = (u32 *)row;
+    for (u32 column = 0; column < framebuffer->width; column++) {
+      u32 x = column + xOffset;
+      u32 expected =
+          (((y / checkerSizeInPixels) & 1) ^ ((x / checkerSizeInPixels) & 1))
+              ? LIGHT_COLOR
+              : DARK_COLOR;
+      if (pixel[column] != expected)
+        return 0;
+    }
+    row += framebuffer->stride;
+  }
+  return 1;
+}
+
+static void Benchmark(struct string_builder *stringBuilder,
+                      struct framebuffer *framebuffer, struct string *name,
+                      b8 isCheckerBoard) {
+  u32 iterationCount = 100;
+  u64 startedAt = Now();
+  for (u32 iteration = 0; iteration < iterationCount; iteration++) {
+    if (isCheckerBoard)
+      DrawCheckerBoard(framebuffer, LIGHT_COLOR, DARK_COLOR, (f32)iteration);
+    else
+      DrawSolid(framebuffer, iteration);
+  }
+  u64 elapsed = Now() - startedAt;
+
+  f32 pixelCount = (f32)framebuffer->width * (f32)framebuffer->height *
+                   (f32)iterationCount;
+  StringBuilderAppendString(stringBuilder, name);
+  StringBuilderAppendString(stringBuilder, &STRING_FROM_ZERO_TERMINATED(" "));
+  StringBuilderAppendF32(stringBuilder, pixelCount / (f32)elapsed, 2);
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED(" pixels/ns\n"));
+  struct string string = StringBuilderFlush(stringBuilder);
+  write(STDOUT_FILENO, string.value, string.length);
+}
+
+int main(void) {
+  enum draw_test_error errorCode = DRAW_TEST_ERROR_NONE;
+
+  struct framebuffer framebuffer = {
+      .width = WIDTH,
+      .height = HEIGHT,
+      .stride = WIDTH * sizeof(u32),
+      .data = (u8 *)pixels,
+  };
+
+  u8 outBufferValue[128];
+  u8 stringBufferValue[32];
+  struct string outBuffer = {.value = outBufferValue,
+                             .length = sizeof(outBufferValue)};
+  struct string stringBuffer = {.value = stringBufferValue,
+                                .length = sizeof(stringBufferValue)};
+  struct string_builder stringBuilder = {
+      .outBuffer = &outBuffer,
+      .stringBuffer = &stringBuffer,
+  };
+
+  __builtin_cpu_init();
+  b8 isSSE2Supported = __builtin_cpu_supports("sse2") != 0;
+  b8 isAVX2Supported = __builtin_cpu_supports("avx2") != 0;
+
+  // DrawSolid(struct framebuffer *framebuffer, u32 color)
+  {
+    FillSpan = FillSpanScalar;
+    DrawSolid(&framebuffer, 0x3b82f6);
+    if (!IsSolid(&framebuffer, 0x3b82f6)) {
+      errorCode = DRAW_TEST_ERROR_DRAW_SOLID_SCALAR;
+      goto end;
+    }
+
+    if (isSSE2Supported) {
+      FillSpan = FillSpanSSE2;
+      DrawSolid(&framebuffer, 0x1e293b);
+      if (!IsSolid(&framebuffer, 0x1e293b)) {
+        errorCode = DRAW_TEST_ERROR_DRAW_SOLID_SSE2;
+        goto end;
+      }
+    }
+
+    if (isAVX2Supported) {
+      FillSpan = FillSpanAVX2;
+      DrawSolid(&framebuffer, 0x3b82f6);
+      if (!IsSolid(&framebuffer, 0x3b82f6)) {
+        errorCode = DRAW_TEST_ERROR_DRAW_SOLID_AVX2;
+        goto end;
+      }
+    }
+
+    // rows that are not multiple of vector width and not aligned
+    DrawInit();
+    struct framebuffer padded = {
+        .width = 1001,
+        .height = 7,
+        .stride = 1003 * sizeof(u32),
+        .data = (u8 *)(pixels + 1),
+    };
+    DrawSolid(&padded, 0x1e293b);
+    if (!IsSolid(&padded, 0x1e293b)) {
+      errorCode = DRAW_TEST_ERROR_DRAW_SOLID_PADDED_STRIDE;
+      goto end;
+    }
+  }
+
+  // DrawCheckerBoard(struct framebuffer *framebuffer, u32 lightColor,
+  //                  u32 darkColor, f32 offset)
+  {
+    FillSpan = FillSpanScalar;
+    DrawCheckerBoard(&framebuffer, LIGHT_COLOR, DARK_COLOR, 0);
+    if (!IsCheckerBoard(&framebuffer, 0)) {
+      errorCode = DRAW_TEST_ERROR_DRAW_CHECKERBOARD_SCALAR;
+      goto end;
+    }
+
+    if (isSSE2Supported) {
+      FillSpan = FillSpanSSE2;
+      DrawCheckerBoard(&framebuffer, LIGHT_COLOR, DARK_COLOR, 0);
+      if (!IsCheckerBoard(&framebuffer, 0)) {
+        errorCode = DRAW_TEST_ERROR_DRAW_CHECKERBOARD_SSE2;
+        goto end;
+      }
+    }
+
+    if (isAVX2Supported) {
+      FillSpan = FillSpanAVX2;
+      DrawCheckerBoard(&framebuffer, LIGHT_COLOR, DARK_COLOR, 0);
+      if (!IsCheckerBoard(&framebuffer, 0)) {
+        errorCode = DRAW_TEST_ERROR_DRAW_CHECKERBOARD_AVX2;
+        goto end;
+      }
+    }
+
+    DrawInit();
+    f32 offsets[] = {0.1f, 34.9f, 35.0f, 69.9f, 1234.5f};
+    for (u32 index = 0; index < sizeof(offsets) / sizeof(*offsets); index++) {
+      DrawCheckerBoard(&framebuffer, LIGHT_COLOR, DARK_COLOR, offsets[index]);
+      if (!IsCheckerBoard(&framebuffer, offsets[index])) {
+        errorCode = DRAW_TEST_ERROR_DRAW_CHECKERBOARD_OFFSET;
+        goto end;
+      }
+    }
+
+    struct framebuffer padded = {
+        .width = 1001,
+        .height = 713,
+        .stride = 1003 * sizeof(u32),
+        .data = (u8 *)(pixels + 1),
+    };
+    DrawCheckerBoard(&padded, LIGHT_COLOR, DARK_COLOR, 12.3f);
+    if (!IsCheckerBoard(&padded, 12.3f)) {
+      errorCode = DRAW_TEST_ERROR_DRAW_CHECKERBOARD_PADDED_STRIDE;
+      goto end;
+    }
+  }
+
+  // DrawCheckerBoardRect(struct framebuffer *framebuffer, struct rect rect,
+  //                      u32 lightColor, u32 darkColor, f32 offset)
+  {
+    DrawSolid(&framebuffer, 0);
+    u16 tileWidth = 256;
+    u16 tileHeight = 32;
+    for (u16 y = 0; y < framebuffer.height; y += tileHeight) {
+      for (u16 x = 0; x < framebuffer.width; x += tileWidth) {
+        struct rect rect = {
+            .x = x, .y = y, .width = tileWidth, .height = tileHeight};
+        DrawCheckerBoardRect(&framebuffer, rect, LIGHT_COLOR, DARK_COLOR,
+                             42.7f);
+      }
+    }
+
+    if (!IsCheckerBoard(&framebuffer, 42.7f)) {
+      errorCode = DRAW_TEST_ERROR_DRAW_CHECKERBOARD_RECT_TILED;
+      goto end;
+    }
+  }
+
+  // DamageAdd(struct damage *damage, struct rect rect)
+  {
+    struct damage damage = {};
+    DamageAdd(&damage, (struct rect){.width = 10, .height = 10});
+    DamageAdd(&damage, (struct rect){.x = 10, .width = 10, .height = 10});
+    struct rect expected = {.width = 20, .height = 10};
+    if (damage.count != 1 || damage.rects[0].x != expected.x ||
+        damage.rects[0].width != expected.width ||
+        damage.rects[0].height != expected.height) {
+      errorCode = DRAW_TEST_ERROR_DAMAGE_ADD_EXPECTED_MERGE_TOUCHING;
+      goto end;
+    }
+
+    DamageReset(&damage);
+    DamageAdd(&damage, (struct rect){.width = 10, .height = 10});
+    DamageAdd(&damage, (struct rect){.x = 100, .width = 10, .height = 10});
+    if (damage.count != 2) {
+      errorCode = DRAW_TEST_ERROR_DAMAGE_ADD_EXPECTED_KEEP_DISJOINT;
+      goto end;
+    }
+
+    DamageReset(&damage);
+    for (u16 index = 0; index < DAMAGE_RECT_MAX * 2; index++) {
+      struct rect rect = {.x = index * 20, .width = 10, .height = 10};
+      DamageAdd(&damage, rect);
+    }
+    u64 coveredArea = 0;
+    for (u32 index = 0; index < damage.count; index++)
+      coveredArea += RectArea(damage.rects[index]);
+    if (damage.count > DAMAGE_RECT_MAX ||
+        coveredArea < DAMAGE_RECT_MAX * 2 * 10 * 10) {
+      errorCode = DRAW_TEST_ERROR_DAMAGE_ADD_EXPECTED_BOUNDED;
+      goto end;
+    }
+  }
+
+  // DrawCheckerBoardDamage(struct framebuffer *framebuffer,
+  //                        f32 previousOffset, f32 offset)
+  {
+    DamageReset(&framebuffer.damage);
+    DrawCheckerBoardDamage(&framebuffer, 12.0f, 12.0f);
+    if (framebuffer.damage.count != 0) {
+      errorCode = DRAW_TEST_ERROR_DRAW_CHECKERBOARD_DAMAGE_EXPECTED_NONE;
+      goto end;
+    }
+
+    // 1920 / 350 -> at most 6 edges on screen
+    DrawCheckerBoardDamage(&framebuffer, 12.0f, 12.5f);
+    u64 damagedArea = 0;
+    for (u32 index = 0; index < framebuffer.damage.count; index++)
+      damagedArea += RectArea(framebuffer.damage.rects[index]);
+    if (framebuffer.damage.count == 0 ||
+        damagedArea > 6 * 5 * (u64)framebuffer.height) {
+      errorCode = DRAW_TEST_ERROR_DRAW_CHECKERBOARD_DAMAGE_EXPECTED_STRIPS;
+      goto end;
+    }
+
+    f32 offsets[][2] = {
+        {12.0f, 12.5f}, {34.5f, 35.2f}, {69.5f, 70.3f},
+        {0.0f, 30.0f},  {10.0f, 60.0f}, {100.0f, 101.0f},
+    };
+    for (u32 index = 0; index < sizeof(offsets) / sizeof(*offsets); index++) {
+      f32 previousOffset = offsets[index][0];
+      f32 offset = offsets[index][1];
+      DrawCheckerBoard(&framebuffer, LIGHT_COLOR, DARK_COLOR, previousOffset);
+
+      // repaint only damaged parts
+      DamageReset(&framebuffer.damage);
+      DrawCheckerBoardDamage(&framebuffer, previousOffset, offset);
+      for (u32 rectIndex = 0; rectIndex < framebuffer.damage.count;
+           rectIndex++)
+        DrawCheckerBoardRect(&framebuffer, framebuffer.damage.rects[rectIndex],
+                             LIGHT_COLOR, DARK_COLOR, offset);
+
+      if (!IsCheckerBoard(&framebuffer, offset)) {
+        errorCode = DRAW_TEST_ERROR_DRAW_CHECKERBOARD_DAMAGE_REPAINT;
+        goto end;
+      }
+    }
+  }
+
+  // benchmark
+  {
+#define BENCHMARK(kernel)                                                      \
+  FillSpan = FillSpan##kernel;                                                 \
+  Benchmark(&stringBuilder, &framebuffer,                                      \
+            &STRING_FROM_ZERO_TERMINATED("DrawSolid " #kernel), 0);           \
+  Benchmark(&stringBuilder, &framebuffer,                                      \
+            &STRING_FROM_ZERO_TERMINATED("DrawCheckerBoard " #kernel), 1)
+
+    BENCHMARK(Scalar);
+    if (isSSE2Supported) {
+      BENCHMARK(SSE2);
+    }
+    if (isAVX2Supported) {
+      BENCHMARK(AVX2);
+    }
+#undef BENCHMARK
+  }
+
+end:
+  return (int)errorCode;
+}
@@ -0,0 +1,169 @@
+#include <libevdev/libevdev-uinput.h>
+#include <poll.h>
+#include <time.h>
+
+#include "evdev.h"
+
+// TODO: Show error pretty error message when a test fails
+enum evdev_test_error {
+  EVDEV_TEST_ERROR_NONE = 0,
+  EVDEV_TEST_ERROR_OPEN_EXPECTED_GAMEPAD,
+  EVDEV_TEST_ERROR_OPEN_EXPECTED_FAIL_WHEN_KIND_NOT_ACCEPTED,
+  EVDEV_TEST_ERROR_READ_EXPECTED_DPAD_PRESSED,
+  EVDEV_TEST_ERROR_READ_EXPECTED_TAP_COUNTED_TWICE,
+  EVDEV_TEST_ERROR_READ_EXPECTED_HAT_AS_DPAD,
+  EVDEV_TEST_ERROR_READ_EXPECTED_STICK_NORMALIZED,
+
+  // src: https://mesonbuild.com/Unit-tests.html#skipped-tests-and-hard-errors
+  // For the default exitcode testing protocol, the GNU standard approach in
+  // this case is to exit the program with error code 77. Meson will detect this
+  // and report these tests as skipped rather than failed. This behavior was
+  // added in version 0.37.0.
+  MESON_TEST_SKIP = 77,
+  // In addition, sometimes a test fails set up so that it should fail even if
+  // it is marked as an expected failure. The GNU standard approach in this case
+  // is to exit the program with error code 99. Again, Meson will detect this
+  // and report these tests as ERROR, ignoring the setting of should_fail. This
+  // behavior was added in version 0.50.0.
+  MESON_TEST_FAILED_TO_SET_UP = 99,
+};
+
+#define STICK_MAX 255
+#define EVENT_COUNT(events) (u32)(sizeof(events) / sizeof(*(events)))
+
+/*
+ * Writes events followed by sync, then waits until device can be read.
+ * @return 0 when events did not arrive
+ */
+static b8 Emit(struct libevdev_uinput *uinput, struct evdev_device *device,
+               u32 (*events)[3], u32 eventCount) {
+  for (u32 index = 0; index < eventCount; index++)
+    libevdev_uinput_write_event(uinput, events[index][0], events[index][1],
+                                (s32)events[index][2]);
+  libevdev_uinput_write_event(uinput, EV_SYN, SYN_REPORT, 0);
+
+  struct pollfd pollfd = {.fd = device->fd, .events = POLLIN};
+  return poll(&pollfd, 1, 1000) == 1;
+}
+
+int main(void) {
+  enum evdev_test_error errorCode = EVDEV_TEST_ERROR_NONE;
+  struct libevdev *libevdev = 0;
+  struct libevdev_uinput *uinput = 0;
+  struct evdev_device device = {.fd = -1};
+
+  // - create virtual gamepad
+  {
+    libevdev = libevdev_new();
+    libevdev_set_name(libevdev, "evdev_test gamepad");
+    libevdev_enable_event_type(libevdev, EV_KEY);
+    u32 buttons[] = {BTN_SOUTH,     BTN_DPAD_UP,   BTN_DPAD_DOWN,
+                     BTN_DPAD_LEFT, BTN_DPAD_RIGHT};
+    for (u32 index = 0; index < sizeof(buttons) / sizeof(*buttons); index++)
+      libevdev_enable_event_code(libevdev, EV_KEY, buttons[index], 0);
+
+    libevdev_enable_event_type(libevdev, EV_ABS);
+    struct input_absinfo stickInfo = {.minimum = 0, .maximum = STICK_MAX};
+    libevdev_enable_event_code(libevdev, EV_ABS, ABS_X, &stickInfo);
+    libevdev_enable_event_code(libevdev, EV_ABS, ABS_Y, &stickInfo);
+    struct input_absinfo hatInfo = {.minimum = -1, .maximum = 1};
+    libevdev_enable_event_code(libevdev, EV_ABS, ABS_HAT0X, &hatInfo);
+    libevdev_enable_event_code(libevdev, EV_ABS, ABS_HAT0Y, &hatInfo);
+
+    s32 error = libevdev_uinput_create_from_device(
+        libevdev, LIBEVDEV_UINPUT_OPEN_MANAGED, &uinput);
+    if (error == -ENOENT || error == -EACCES || error == -EPERM) {
+      // no uinput in containers or without permission
+      errorCode = MESON_TEST_SKIP;
+      goto end;
+    } else if (error != 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+  }
+
+  // EvdevDeviceOpen(struct evdev_device *device, const char *path, u32 kinds)
+  {
+    const char *path = libevdev_uinput_get_devnode(uinput);
+    if (!path) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+
+    if (EvdevDeviceOpen(&device, path, EVDEV_DEVICE_KEYBOARD)) {
+      errorCode = EVDEV_TEST_ERROR_OPEN_EXPECTED_FAIL_WHEN_KIND_NOT_ACCEPTED;
+      goto end;
+    }
+
+    // device node is created by udev after uinput device, wait for it
+    b8 isOpened = 0;
+    for (u32 try = 0; try < 100 && !isOpened; try++) {
+      isOpened = EvdevDeviceOpen(&device, path,
+                                 EVDEV_DEVICE_GAMEPAD | EVDEV_DEVICE_KEYBOARD);
+      if (!isOpened)
+        nanosleep(&(struct timespec){.tv_nsec = 10 * 1000 * 1000}, 0);
+    }
+    if (!isOpened || device.kind != EVDEV_DEVICE_GAMEPAD) {
+      errorCode = EVDEV_TEST_ERROR_OPEN_EXPECTED_GAMEPAD;
+      goto end;
+    }
+  }
+
+  // EvdevDeviceRead(struct evdev_device *device, struct input *input)
+  {
+    struct input input = {};
+
+    u32 press[][3] = {{EV_KEY, BTN_DPAD_UP, 1}};
+    if (!Emit(uinput, &device, press, EVENT_COUNT(press)) ||
+        !EvdevDeviceRead(&device, &input) || !input.up.isPressed ||
+        input.up.transitionCount != 1) {
+      errorCode = EVDEV_TEST_ERROR_READ_EXPECTED_DPAD_PRESSED;
+      goto end;
+    }
+    InputEndFrame(&input);
+
+    // - tap between two reads
+    u32 tap[][3] = {{EV_KEY, BTN_DPAD_DOWN, 1}};
+    u32 untap[][3] = {{EV_KEY, BTN_DPAD_DOWN, 0}};
+    if (!Emit(uinput, &device, tap, EVENT_COUNT(tap)) ||
+        !Emit(uinput, &device, untap, EVENT_COUNT(untap)) ||
+        !EvdevDeviceRead(&device, &input) || input.down.isPressed ||
+        input.down.transitionCount != 2) {
+      errorCode = EVDEV_TEST_ERROR_READ_EXPECTED_TAP_COUNTED_TWICE;
+      goto end;
+    }
+    InputEndFrame(&input);
+
+    u32 hatLeft[][3] = {{EV_ABS, ABS_HAT0X, (u32)-1}};
+    if (!Emit(uinput, &device, hatLeft, EVENT_COUNT(hatLeft)) ||
+        !EvdevDeviceRead(&device, &input) || !input.left.isPressed ||
+        input.right.isPressed) {
+      errorCode = EVDEV_TEST_ERROR_READ_EXPECTED_HAT_AS_DPAD;
+      goto end;
+    }
+    u32 hatRight[][3] = {{EV_ABS, ABS_HAT0X, 1}};
+    if (!Emit(uinput, &device, hatRight, EVENT_COUNT(hatRight)) ||
+        !EvdevDeviceRead(&device, &input) || input.left.isPressed ||
+        !input.right.isPressed) {
+      errorCode = EVDEV_TEST_ERROR_READ_EXPECTED_HAT_AS_DPAD;
+      goto end;
+    }
+
+    u32 stick[][3] = {{EV_ABS, ABS_X, STICK_MAX}, {EV_ABS, ABS_Y, 0}};
+    if (!Emit(uinput, &device, stick, EVENT_COUNT(stick)) ||
+        !EvdevDeviceRead(&device, &input) || input.stickX != 1.0f ||
+        input.stickY != -1.0f) {
+      errorCode = EVDEV_TEST_ERROR_READ_EXPECTED_STICK_NORMALIZED;
+      goto end;
+    }
+  }
+
+end:
+  if (device.fd != -1)
+    EvdevDeviceClose(&device);
+  if (uinput)
+    libevdev_uinput_destroy(uinput);
+  if (libevdev)
+    libevdev_free(libevdev);
+  return (int)errorCode;
+}
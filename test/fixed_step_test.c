@@ -0,0 +1,92 @@
+#include "fixed_step.h"
+
+// TODO: Show error pretty error message when a test fails
+enum fixed_step_test_error {
+  FIXED_STEP_TEST_ERROR_NONE = 0,
+  FIXED_STEP_TEST_ERROR_ADVANCE_EXPECTED_NO_STEP_BEFORE_STEP_TIME,
+  FIXED_STEP_TEST_ERROR_ADVANCE_EXPECTED_STEP_WHEN_ACCUMULATED,
+  FIXED_STEP_TEST_ERROR_ALPHA_EXPECTED_FRACTION_OF_STEP,
+  FIXED_STEP_TEST_ERROR_ADVANCE_EXPECTED_STEP_MAX_AFTER_STALL,
+  FIXED_STEP_TEST_ERROR_ADVANCE_EXPECTED_SAME_STEPS_FOR_ANY_FRAME_RATE,
+
+  // src: https://mesonbuild.com/Unit-tests.html#skipped-tests-and-hard-errors
+  // For the default exitcode testing protocol, the GNU standard approach in
+  // this case is to exit the program with error code 77. Meson will detect this
+  // and report these tests as skipped rather than failed. This behavior was
+  // added in version 0.37.0.
+  MESON_TEST_SKIP = 77,
+  // In addition, sometimes a test fails set up so that it should fail even if
+  // it is marked as an expected failure. The GNU standard approach in this case
+  // is to exit the program with error code 99. Again, Meson will detect this
+  // and report these tests as ERROR, ignoring the setting of should_fail. This
+  // behavior was added in version 0.50.0.
+  MESON_TEST_FAILED_TO_SET_UP = 99,
+};
+
+// 100Hz, so step is exactly 10ms
+#define RATE 100
+#define STEP_MAX 8
+#define MILLISECONDS 1000000
+
+int main(void) {
+  enum fixed_step_test_error errorCode = FIXED_STEP_TEST_ERROR_NONE;
+
+  // FixedStepAdvance(struct fixed_step *fixedStep, u64 elapsed)
+  // FixedStepAlpha(struct fixed_step *fixedStep)
+  {
+    struct fixed_step fixedStep;
+    FixedStepInit(&fixedStep, RATE, STEP_MAX);
+
+    if (FixedStepAdvance(&fixedStep, 4 * MILLISECONDS) != 0) {
+      errorCode = FIXED_STEP_TEST_ERROR_ADVANCE_EXPECTED_NO_STEP_BEFORE_STEP_TIME;
+      goto end;
+    }
+
+    if (FixedStepAdvance(&fixedStep, 8 * MILLISECONDS) != 1) {
+      errorCode = FIXED_STEP_TEST_ERROR_ADVANCE_EXPECTED_STEP_WHEN_ACCUMULATED;
+      goto end;
+    }
+
+    // - 2ms of 10ms step left
+    f32 alpha = FixedStepAlpha(&fixedStep);
+    if (alpha < 0.19f || alpha > 0.21f) {
+      errorCode = FIXED_STEP_TEST_ERROR_ALPHA_EXPECTED_FRACTION_OF_STEP;
+      goto end;
+    }
+
+    // - 1 second stall
+    u32 stepCount = FixedStepAdvance(&fixedStep, 1000 * MILLISECONDS);
+    if (stepCount != STEP_MAX ||
+        fixedStep.droppedTime != 1000 * MILLISECONDS - STEP_MAX * 10 *
+                                                           MILLISECONDS ||
+        fixedStep.accumulator != 2 * MILLISECONDS) {
+      errorCode = FIXED_STEP_TEST_ERROR_ADVANCE_EXPECTED_STEP_MAX_AFTER_STALL;
+      goto end;
+    }
+  }
+
+  // - simulation does not depend on how time is split into frames
+  {
+    struct fixed_step fast;
+    struct fixed_step slow;
+    FixedStepInit(&fast, RATE, STEP_MAX);
+    FixedStepInit(&slow, RATE, STEP_MAX);
+
+    u32 fastStepCount = 0;
+    u32 slowStepCount = 0;
+    // 1 second at 144Hz and at 30Hz
+    for (u32 index = 0; index < 144; index++)
+      fastStepCount += FixedStepAdvance(&fast, 1000 * MILLISECONDS / 144);
+    for (u32 index = 0; index < 30; index++)
+      slowStepCount += FixedStepAdvance(&slow, 1000 * MILLISECONDS / 30);
+    // division leaves few nanoseconds out, both fall just short of 100
+    if (fastStepCount != slowStepCount || fastStepCount != RATE - 1) {
+      errorCode =
+          FIXED_STEP_TEST_ERROR_ADVANCE_EXPECTED_SAME_STEPS_FOR_ANY_FRAME_RATE;
+      goto end;
+    }
+  }
+
+end:
+  return (int)errorCode;
+}
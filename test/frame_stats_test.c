@@ -0,0 +1,103 @@
+#include "frame_stats.h"
+
+// TODO: Show error pretty error message when a test fails
+enum frame_stats_test_error {
+  FRAME_STATS_TEST_ERROR_NONE = 0,
+  FRAME_STATS_TEST_ERROR_REPORT_EXPECTED_EMPTY,
+  FRAME_STATS_TEST_ERROR_SORT_EXPECTED_ASCENDING,
+  FRAME_STATS_TEST_ERROR_REPORT_EXPECTED_PERCENTILES,
+  FRAME_STATS_TEST_ERROR_REPORT_EXPECTED_ONLY_LAST_FRAMES,
+  FRAME_STATS_TEST_ERROR_REPORT_EXPECTED_ARENA_RELEASED,
+
+  // src: https://mesonbuild.com/Unit-tests.html#skipped-tests-and-hard-errors
+  // For the default exitcode testing protocol, the GNU standard approach in
+  // this case is to exit the program with error code 77. Meson will detect this
+  // and report these tests as skipped rather than failed. This behavior was
+  // added in version 0.37.0.
+  MESON_TEST_SKIP = 77,
+  // In addition, sometimes a test fails set up so that it should fail even if
+  // it is marked as an expected failure. The GNU standard approach in this case
+  // is to exit the program with error code 99. Again, Meson will detect this
+  // and report these tests as ERROR, ignoring the setting of should_fail. This
+  // behavior was added in version 0.50.0.
+  MESON_TEST_FAILED_TO_SET_UP = 99,
+};
+
+#define CAPACITY 128
+
+int main(void) {
+  enum frame_stats_test_error errorCode = FRAME_STATS_TEST_ERROR_NONE;
+  struct memory_arena memory;
+
+  {
+    u64 KILOBYTES = 1 << 10;
+    u64 total = 8 * KILOBYTES;
+    memory = (struct memory_arena){.block = alloca(total), .total = total};
+    if (memory.block == 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+    bzero(memory.block, memory.total);
+  }
+
+  struct frame_stats stats;
+  FrameStatsInit(&stats, &memory, CAPACITY);
+
+  // FrameStatsReport(struct frame_stats *stats, struct memory_arena *arena)
+  {
+    struct frame_stats_report report = FrameStatsReport(&stats, &memory);
+    if (report.count != 0) {
+      errorCode = FRAME_STATS_TEST_ERROR_REPORT_EXPECTED_EMPTY;
+      goto end;
+    }
+  }
+
+  // FrameStatsSort(u64 *values, u64 *temp, u64 count)
+  {
+    // - values that differ in every byte
+    u64 values[] = {
+        0xff00000000000000, 3, 0x100, 0, 0x0102030405060708, 3, 0xffffffff,
+    };
+    u64 temp[sizeof(values) / sizeof(*values)];
+    u64 count = sizeof(values) / sizeof(*values);
+    FrameStatsSort(values, temp, count);
+    for (u64 index = 1; index < count; index++) {
+      if (values[index - 1] > values[index]) {
+        errorCode = FRAME_STATS_TEST_ERROR_SORT_EXPECTED_ASCENDING;
+        goto end;
+      }
+    }
+  }
+
+  // FrameStatsRecord(struct frame_stats *stats, u64 duration)
+  {
+    // - 1..100 in shuffled order
+    for (u64 index = 0; index < 100; index++)
+      FrameStatsRecord(&stats, (index * 37) % 100 + 1);
+
+    u64 usedBefore = memory.used;
+    struct frame_stats_report report = FrameStatsReport(&stats, &memory);
+    if (report.count != 100 || report.p50 != 50 || report.p99 != 99 ||
+        report.max != 100) {
+      errorCode = FRAME_STATS_TEST_ERROR_REPORT_EXPECTED_PERCENTILES;
+      goto end;
+    }
+    if (memory.used != usedBefore) {
+      errorCode = FRAME_STATS_TEST_ERROR_REPORT_EXPECTED_ARENA_RELEASED;
+      goto end;
+    }
+
+    // - first frames fall out of ring
+    for (u64 index = 0; index < CAPACITY; index++)
+      FrameStatsRecord(&stats, 1000);
+    report = FrameStatsReport(&stats, &memory);
+    if (report.count != CAPACITY || report.p50 != 1000 ||
+        report.max != 1000 || stats.count != 100 + CAPACITY) {
+      errorCode = FRAME_STATS_TEST_ERROR_REPORT_EXPECTED_ONLY_LAST_FRAMES;
+      goto end;
+    }
+  }
+
+end:
+  return (int)errorCode;
+}
@@ -0,0 +1,153 @@
+#include <pthread.h>
+#include <sched.h>
+
+#include "input.h"
+
+// TODO: Show error pretty error message when a test fails
+enum input_test_error {
+  INPUT_TEST_ERROR_NONE = 0,
+  INPUT_TEST_ERROR_POP_EXPECTED_EMPTY,
+  INPUT_TEST_ERROR_POP_EXPECTED_PUSH_ORDER,
+  INPUT_TEST_ERROR_PUSH_EXPECTED_DROP_WHEN_FULL,
+  INPUT_TEST_ERROR_TAKE_DROPPED_EXPECTED_COUNT_ONCE,
+  INPUT_TEST_ERROR_THREAD_EXPECTED_EVERY_EVENT_IN_ORDER,
+
+  // src: https://mesonbuild.com/Unit-tests.html#skipped-tests-and-hard-errors
+  // For the default exitcode testing protocol, the GNU standard approach in
+  // this case is to exit the program with error code 77. Meson will detect this
+  // and report these tests as skipped rather than failed. This behavior was
+  // added in version 0.37.0.
+  MESON_TEST_SKIP = 77,
+  // In addition, sometimes a test fails set up so that it should fail even if
+  // it is marked as an expected failure. The GNU standard approach in this case
+  // is to exit the program with error code 99. Again, Meson will detect this
+  // and report these tests as ERROR, ignoring the setting of should_fail. This
+  // behavior was added in version 0.50.0.
+  MESON_TEST_FAILED_TO_SET_UP = 99,
+};
+
+#define QUEUE_CAPACITY 8
+#define THREAD_EVENT_COUNT 100000
+
+static void *ProduceEvents(void *data) {
+  struct input_queue *queue = data;
+  for (u32 index = 0; index < THREAD_EVENT_COUNT; index++) {
+    struct input_queue_event event = {
+        .time = index,
+        .type = INPUT_EVENT_KEY,
+        .isPressed = index & 1,
+        .code = index * 3,
+    };
+    // consumer is behind, wait instead of dropping
+    while (!InputQueuePush(queue, &event))
+      sched_yield();
+  }
+  return 0;
+}
+
+int main(void) {
+  enum input_test_error errorCode = INPUT_TEST_ERROR_NONE;
+  struct memory_arena memory;
+
+  {
+    u64 KILOBYTES = 1 << 10;
+    u64 total = 4 * KILOBYTES;
+    memory = (struct memory_arena){.block = alloca(total), .total = total};
+    if (memory.block == 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+    bzero(memory.block, memory.total);
+  }
+
+  struct input_queue queue;
+  InputQueueInit(&queue, &memory, QUEUE_CAPACITY);
+
+  // InputQueuePush(struct input_queue *queue, struct input_queue_event *event)
+  // InputQueuePop(struct input_queue *queue, struct input_queue_event *event)
+  {
+    struct input_queue_event event;
+    if (InputQueuePop(&queue, &event)) {
+      errorCode = INPUT_TEST_ERROR_POP_EXPECTED_EMPTY;
+      goto end;
+    }
+
+    // - tap shorter than a frame keeps both events
+    struct input_queue_event press = {
+        .time = 10, .type = INPUT_EVENT_KEY, .isPressed = 1, .code = 38};
+    struct input_queue_event release = {
+        .time = 12, .type = INPUT_EVENT_KEY, .isPressed = 0, .code = 38};
+    InputQueuePush(&queue, &press);
+    InputQueuePush(&queue, &release);
+    if (!InputQueuePop(&queue, &event) || event.time != 10 ||
+        !event.isPressed || !InputQueuePop(&queue, &event) ||
+        event.time != 12 || event.isPressed) {
+      errorCode = INPUT_TEST_ERROR_POP_EXPECTED_PUSH_ORDER;
+      goto end;
+    }
+    if (InputQueuePop(&queue, &event)) {
+      errorCode = INPUT_TEST_ERROR_POP_EXPECTED_EMPTY;
+      goto end;
+    }
+
+    // - indices go past capacity
+    for (u32 index = 0; index < QUEUE_CAPACITY; index++) {
+      event = (struct input_queue_event){.time = index};
+      if (!InputQueuePush(&queue, &event)) {
+        errorCode = INPUT_TEST_ERROR_PUSH_EXPECTED_DROP_WHEN_FULL;
+        goto end;
+      }
+    }
+    event = (struct input_queue_event){.time = QUEUE_CAPACITY};
+    if (InputQueuePush(&queue, &event) || queue.droppedCount != 1) {
+      errorCode = INPUT_TEST_ERROR_PUSH_EXPECTED_DROP_WHEN_FULL;
+      goto end;
+    }
+
+    // InputQueueTakeDropped(struct input_queue *queue)
+    if (InputQueueTakeDropped(&queue) != 1 ||
+        InputQueueTakeDropped(&queue) != 0) {
+      errorCode = INPUT_TEST_ERROR_TAKE_DROPPED_EXPECTED_COUNT_ONCE;
+      goto end;
+    }
+
+    for (u32 index = 0; index < QUEUE_CAPACITY; index++) {
+      if (!InputQueuePop(&queue, &event) || event.time != index) {
+        errorCode = INPUT_TEST_ERROR_POP_EXPECTED_PUSH_ORDER;
+        goto end;
+      }
+    }
+    if (InputQueuePop(&queue, &event)) {
+      errorCode = INPUT_TEST_ERROR_POP_EXPECTED_EMPTY;
+      goto end;
+    }
+  }
+
+  // producer and consumer on different threads
+  {
+    pthread_t producer;
+    if (pthread_create(&producer, 0, ProduceEvents, &queue) != 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+
+    u32 expectedTime = 0;
+    while (expectedTime < THREAD_EVENT_COUNT) {
+      struct input_queue_event event;
+      if (!InputQueuePop(&queue, &event)) {
+        sched_yield();
+        continue;
+      }
+
+      // keep draining on error, so producer can finish
+      if (event.time != expectedTime || event.code != expectedTime * 3 ||
+          event.isPressed != (expectedTime & 1))
+        errorCode = INPUT_TEST_ERROR_THREAD_EXPECTED_EVERY_EVENT_IN_ORDER;
+      expectedTime++;
+    }
+    pthread_join(producer, 0);
+  }
+
+end:
+  return (int)errorCode;
+}
@@ -0,0 +1,211 @@
+#include "job.h"
+
+// TODO: Show error pretty error message when a test fails
+enum job_test_error {
+  JOB_TEST_ERROR_NONE = 0,
+  JOB_TEST_ERROR_DEQUE_POP_EXPECTED_LAST_PUSHED,
+  JOB_TEST_ERROR_DEQUE_STEAL_EXPECTED_FIRST_PUSHED,
+  JOB_TEST_ERROR_DEQUE_EXPECTED_EMPTY,
+  JOB_TEST_ERROR_DEQUE_PUSH_EXPECTED_FULL,
+  JOB_TEST_ERROR_QUEUE_EXPECTED_ALL_JOBS_RUN,
+  JOB_TEST_ERROR_QUEUE_EXPECTED_ON_COMPLETE_CALLED_ONCE,
+  JOB_TEST_ERROR_QUEUE_EXPECTED_NESTED_JOBS_RUN,
+  JOB_TEST_ERROR_QUEUE_SINGLE_WORKER_EXPECTED_ALL_JOBS_RUN,
+
+  // src: https://mesonbuild.com/Unit-tests.html#skipped-tests-and-hard-errors
+  // For the default exitcode testing protocol, the GNU standard approach in
+  // this case is to exit the program with error code 77. Meson will detect this
+  // and report these tests as skipped rather than failed. This behavior was
+  // added in version 0.37.0.
+  MESON_TEST_SKIP = 77,
+  // In addition, sometimes a test fails set up so that it should fail even if
+  // it is marked as an expected failure. The GNU standard approach in this case
+  // is to exit the program with error code 99. Again, Meson will detect this
+  // and report these tests as ERROR, ignoring the setting of should_fail. This
+  // behavior was added in version 0.50.0.
+  MESON_TEST_FAILED_TO_SET_UP = 99,
+};
+
+#define JOB_COUNT 10000
+#define NESTED_CHILD_COUNT 16
+
+struct add_job {
+  struct job job;
+  u64 *sum;
+  u64 value;
+  struct job_queue *queue;
+  struct add_job *children;
+};
+
+static struct add_job jobs[JOB_COUNT];
+static struct add_job childJobs[JOB_COUNT / 100][NESTED_CHILD_COUNT];
+static struct job_deque deque;
+static u32 onCompleteCallCount;
+
+static void AddJob(struct job *job) {
+  struct add_job *addJob = (struct add_job *)job;
+  __atomic_add_fetch(addJob->sum, addJob->value, __ATOMIC_RELAXED);
+}
+
+static void SpawnJob(struct job *job) {
+  struct add_job *addJob = (struct add_job *)job;
+  JobCounterAdd(job->counter, NESTED_CHILD_COUNT);
+  for (u32 index = 0; index < NESTED_CHILD_COUNT; index++) {
+    struct add_job *child = addJob->children + index;
+    *child = (struct add_job){
+        .job = {.work = AddJob, .counter = job->counter},
+        .sum = addJob->sum,
+        .value = 1,
+    };
+    JobQueuePush(addJob->queue, &child->job);
+  }
+  JobQueueWake(addJob->queue);
+}
+
+static void OnComplete(struct job_counter *counter) {
+  __atomic_add_fetch(&onCompleteCallCount, 1, __ATOMIC_RELAXED);
+}
+
+static enum job_test_error RunAddJobs(struct job_queue *queue) {
+  u64 sum = 0;
+  struct job_counter counter = {.onComplete = OnComplete};
+  onCompleteCallCount = 0;
+
+  JobCounterAdd(&counter, JOB_COUNT);
+  for (u32 index = 0; index < JOB_COUNT; index++) {
+    struct add_job *addJob = jobs + index;
+    *addJob = (struct add_job){
+        .job = {.work = AddJob, .counter = &counter},
+        .sum = &sum,
+        .value = index + 1,
+    };
+    JobQueuePush(queue, &addJob->job);
+  }
+  JobQueueWake(queue);
+  JobCounterWait(queue, &counter);
+
+  u64 expected = (u64)JOB_COUNT * (JOB_COUNT + 1) / 2;
+  if (__atomic_load_n(&sum, __ATOMIC_ACQUIRE) != expected)
+    return queue->workerCount == 1
+               ? JOB_TEST_ERROR_QUEUE_SINGLE_WORKER_EXPECTED_ALL_JOBS_RUN
+               : JOB_TEST_ERROR_QUEUE_EXPECTED_ALL_JOBS_RUN;
+
+  if (__atomic_load_n(&onCompleteCallCount, __ATOMIC_ACQUIRE) != 1)
+    return JOB_TEST_ERROR_QUEUE_EXPECTED_ON_COMPLETE_CALLED_ONCE;
+
+  return JOB_TEST_ERROR_NONE;
+}
+
+int main(void) {
+  enum job_test_error errorCode = JOB_TEST_ERROR_NONE;
+  struct memory_arena memory;
+
+  {
+    u64 KILOBYTES = 1 << 10;
+    u64 total = 128 * KILOBYTES;
+    memory = (struct memory_arena){.block = alloca(total), .total = total};
+    if (memory.block == 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+    bzero(memory.block, memory.total);
+  }
+
+  // JobDequePush(struct job_deque *deque, struct job *job)
+  // JobDequePop(struct job_deque *deque)
+  // JobDequeSteal(struct job_deque *deque)
+  {
+    struct job first, second, third;
+    JobDequePush(&deque, &first);
+    JobDequePush(&deque, &second);
+    JobDequePush(&deque, &third);
+
+    if (JobDequePop(&deque) != &third) {
+      errorCode = JOB_TEST_ERROR_DEQUE_POP_EXPECTED_LAST_PUSHED;
+      goto end;
+    }
+
+    if (JobDequeSteal(&deque) != &first) {
+      errorCode = JOB_TEST_ERROR_DEQUE_STEAL_EXPECTED_FIRST_PUSHED;
+      goto end;
+    }
+
+    if (JobDequePop(&deque) != &second || JobDequePop(&deque) != 0 ||
+        JobDequeSteal(&deque) != 0) {
+      errorCode = JOB_TEST_ERROR_DEQUE_EXPECTED_EMPTY;
+      goto end;
+    }
+
+    for (u32 index = 0; index < JOB_DEQUE_CAPACITY; index++)
+      JobDequePush(&deque, &first);
+    if (JobDequePush(&deque, &first)) {
+      errorCode = JOB_TEST_ERROR_DEQUE_PUSH_EXPECTED_FULL;
+      goto end;
+    }
+  }
+
+  // JobQueuePush(struct job_queue *queue, struct job *job) with 1 worker
+  {
+    struct memory_temp tempMemory = MemoryTempBegin(&memory);
+    struct job_queue queue;
+    if (!JobQueueInit(&queue, &memory, 1)) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+
+    errorCode = RunAddJobs(&queue);
+    JobQueueDestroy(&queue);
+    MemoryTempEnd(&tempMemory);
+    if (errorCode != JOB_TEST_ERROR_NONE)
+      goto end;
+  }
+
+  // JobQueuePush(struct job_queue *queue, struct job *job) with 4 workers
+  {
+    struct memory_temp tempMemory = MemoryTempBegin(&memory);
+    struct job_queue queue;
+    if (!JobQueueInit(&queue, &memory, 4)) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+
+    // run many times to shake out races
+    for (u32 round = 0; round < 64; round++) {
+      errorCode = RunAddJobs(&queue);
+      if (errorCode != JOB_TEST_ERROR_NONE)
+        break;
+    }
+
+    // jobs that push jobs from worker threads
+    if (errorCode == JOB_TEST_ERROR_NONE) {
+      u64 sum = 0;
+      struct job_counter counter = {};
+      u32 spawnCount = JOB_COUNT / 100;
+      JobCounterAdd(&counter, spawnCount);
+      for (u32 index = 0; index < spawnCount; index++) {
+        struct add_job *spawnJob = jobs + index;
+        *spawnJob = (struct add_job){
+            .job = {.work = SpawnJob, .counter = &counter},
+            .sum = &sum,
+            .queue = &queue,
+            .children = childJobs[index],
+        };
+        JobQueuePush(&queue, &spawnJob->job);
+      }
+      JobQueueWake(&queue);
+      JobCounterWait(&queue, &counter);
+
+      if (__atomic_load_n(&sum, __ATOMIC_ACQUIRE) !=
+          spawnCount * NESTED_CHILD_COUNT)
+        errorCode = JOB_TEST_ERROR_QUEUE_EXPECTED_NESTED_JOBS_RUN;
+    }
+
+    JobQueueDestroy(&queue);
+    MemoryTempEnd(&tempMemory);
+    if (errorCode != JOB_TEST_ERROR_NONE)
+      goto end;
+  }
+
+end:
+  return (int)errorCode;
+}
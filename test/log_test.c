@@ -0,0 +1,141 @@
+#include <string.h>
+
+#include "log.h"
+
+// TODO: Show error pretty error message when a test fails
+enum log_test_error {
+  LOG_TEST_ERROR_NONE = 0,
+  LOG_TEST_ERROR_SWAP_EXPECTED_EMPTY_WHEN_NOTHING_LOGGED,
+  LOG_TEST_ERROR_SWAP_EXPECTED_ALL_MESSAGES,
+  LOG_TEST_ERROR_SWAP_EXPECTED_EMPTY_WHILE_WRITING,
+  LOG_TEST_ERROR_APPEND_EXPECTED_MESSAGE_IN_OTHER_BUFFER,
+  LOG_TEST_ERROR_WRITE_DONE_EXPECTED_REST_ON_SHORT_WRITE,
+  LOG_TEST_ERROR_WRITE_DONE_EXPECTED_RETRY_ON_EAGAIN,
+  LOG_TEST_ERROR_WRITE_DONE_EXPECTED_FINISH_ON_ERROR,
+  LOG_TEST_ERROR_APPEND_EXPECTED_DROP_WHEN_FULL,
+  LOG_TEST_ERROR_SWAP_EXPECTED_DROPPED_NOTICE,
+
+  // src: https://mesonbuild.com/Unit-tests.html#skipped-tests-and-hard-errors
+  // For the default exitcode testing protocol, the GNU standard approach in
+  // this case is to exit the program with error code 77. Meson will detect this
+  // and report these tests as skipped rather than failed. This behavior was
+  // added in version 0.37.0.
+  MESON_TEST_SKIP = 77,
+  // In addition, sometimes a test fails set up so that it should fail even if
+  // it is marked as an expected failure. The GNU standard approach in this case
+  // is to exit the program with error code 99. Again, Meson will detect this
+  // and report these tests as ERROR, ignoring the setting of should_fail. This
+  // behavior was added in version 0.50.0.
+  MESON_TEST_FAILED_TO_SET_UP = 99,
+};
+
+static b8 IsStringEqualZeroTerminated(struct string *string, char *expected) {
+  u64 length = strlen(expected);
+  return string->length == length &&
+         memcmp(string->value, expected, length) == 0;
+}
+
+int main(void) {
+  enum log_test_error errorCode = LOG_TEST_ERROR_NONE;
+  struct memory_arena memory;
+
+  {
+    u64 KILOBYTES = 1 << 10;
+    u64 total = 1 * KILOBYTES;
+    memory = (struct memory_arena){.block = alloca(total), .total = total};
+    if (memory.block == 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+    bzero(memory.block, memory.total);
+  }
+
+  struct log log;
+  LogInit(&log, &memory, 32);
+
+  // LogSwap(struct log *log)
+  {
+    struct string pending = LogSwap(&log);
+    if (pending.length != 0) {
+      errorCode = LOG_TEST_ERROR_SWAP_EXPECTED_EMPTY_WHEN_NOTHING_LOGGED;
+      goto end;
+    }
+
+    LogAppend(&log, &STRING_FROM_ZERO_TERMINATED("abc\n"));
+    LogAppend(&log, &STRING_FROM_ZERO_TERMINATED("def\n"));
+    pending = LogSwap(&log);
+    if (!IsStringEqualZeroTerminated(&pending, "abc\ndef\n")) {
+      errorCode = LOG_TEST_ERROR_SWAP_EXPECTED_ALL_MESSAGES;
+      goto end;
+    }
+
+    // messages while writing go to other buffer
+    LogAppend(&log, &STRING_FROM_ZERO_TERMINATED("ghi\n"));
+    if (LogSwap(&log).length != 0) {
+      errorCode = LOG_TEST_ERROR_SWAP_EXPECTED_EMPTY_WHILE_WRITING;
+      goto end;
+    }
+    if (!IsStringEqualZeroTerminated(&pending, "abc\ndef\n")) {
+      errorCode = LOG_TEST_ERROR_APPEND_EXPECTED_MESSAGE_IN_OTHER_BUFFER;
+      goto end;
+    }
+  }
+
+  // LogWriteDone(struct log *log, s64 written)
+  {
+    struct string pending = LogWriteDone(&log, 3);
+    if (!IsStringEqualZeroTerminated(&pending, "\ndef\n")) {
+      errorCode = LOG_TEST_ERROR_WRITE_DONE_EXPECTED_REST_ON_SHORT_WRITE;
+      goto end;
+    }
+
+    pending = LogWriteDone(&log, -EAGAIN);
+    if (!IsStringEqualZeroTerminated(&pending, "\ndef\n")) {
+      errorCode = LOG_TEST_ERROR_WRITE_DONE_EXPECTED_RETRY_ON_EAGAIN;
+      goto end;
+    }
+
+    pending = LogWriteDone(&log, 5);
+    if (pending.length != 0 || log.isWriting) {
+      errorCode = LOG_TEST_ERROR_WRITE_DONE_EXPECTED_REST_ON_SHORT_WRITE;
+      goto end;
+    }
+
+    pending = LogSwap(&log);
+    if (!IsStringEqualZeroTerminated(&pending, "ghi\n")) {
+      errorCode = LOG_TEST_ERROR_APPEND_EXPECTED_MESSAGE_IN_OTHER_BUFFER;
+      goto end;
+    }
+
+    pending = LogWriteDone(&log, -EPIPE);
+    if (pending.length != 0 || log.isWriting) {
+      errorCode = LOG_TEST_ERROR_WRITE_DONE_EXPECTED_FINISH_ON_ERROR;
+      goto end;
+    }
+  }
+
+  // LogAppend(struct log *log, struct string *message) when full
+  {
+    struct string message =
+        STRING_FROM_ZERO_TERMINATED("0123456789abcdef0123456789\n");
+    if (!LogAppend(&log, &message)) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+    if (LogAppend(&log, &message) || log.droppedLength != message.length) {
+      errorCode = LOG_TEST_ERROR_APPEND_EXPECTED_DROP_WHEN_FULL;
+      goto end;
+    }
+
+    LogSwap(&log);
+    LogWriteDone(&log, (s64)message.length);
+    struct string pending = LogSwap(&log);
+    if (!IsStringEqualZeroTerminated(&pending, "log: dropped 27 bytes\n")) {
+      errorCode = LOG_TEST_ERROR_SWAP_EXPECTED_DROPPED_NOTICE;
+      goto end;
+    }
+  }
+
+end:
+  return (int)errorCode;
+}
@@ -1,3 +1,10 @@
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "StringBuilder.h"
 #include "memory.h"
 
 // TODO: Show error pretty error message when a test fails
@@ -10,6 +17,22 @@ enum memory_test_error {
   MEMORY_TEST_ERROR_MEM_CHUNK_PUSH_EXPECTED_VALID_ADDRESS_3,
   MEMORY_TEST_ERROR_MEM_CHUNK_PUSH_EXPECTED_NULL,
   MEMORY_TEST_ERROR_MEM_CHUNK_POP_EXPECTED_SAME_ADDRESS,
+  MEMORY_TEST_ERROR_MEM_POOL_PUSH_EXPECTED_VALID_ADDRESS,
+  MEMORY_TEST_ERROR_MEM_POOL_PUSH_EXPECTED_NULL,
+  MEMORY_TEST_ERROR_MEM_POOL_POP_EXPECTED_LOWEST_ADDRESS,
+  MEMORY_TEST_ERROR_MEM_POOL_EXPECTED_DATA_AVAILABLE,
+  MEMORY_TEST_ERROR_MEM_RESERVE_EXPECTED_NOTHING_COMMITTED,
+  MEMORY_TEST_ERROR_MEM_RESERVE_PUSH_EXPECTED_COMMIT_ON_DEMAND,
+  MEMORY_TEST_ERROR_MEM_RESERVE_SUB_EXPECTED_MASTER_DATA_KEPT,
+  MEMORY_TEST_ERROR_MEM_RESERVE_SUB_EXPECTED_NOT_COMMITTED_BY_MASTER,
+  MEMORY_TEST_ERROR_MEM_RESERVE_PUSH_EXPECTED_NULL_WHEN_FULL,
+  MEMORY_TEST_ERROR_MEM_DECOMMIT_EXPECTED_COMMIT_AGAIN,
+  MEMORY_TEST_ERROR_MEM_SCRATCH_EXPECTED_OTHER_ARENA_ON_CONFLICT,
+  MEMORY_TEST_ERROR_MEM_SCRATCH_EXPECTED_RELEASE_AT_SCOPE_END,
+  MEMORY_TEST_ERROR_MEM_SCRATCH_EXPECTED_ARENA_PER_THREAD,
+  MEMORY_TEST_ERROR_MEM_SCRATCH_EXPECTED_NO_OVERWRITE,
+  MEMORY_TEST_ERROR_MEM_STATS_EXPECTED_PUSH_COUNTED,
+  MEMORY_TEST_ERROR_MEM_STATS_EXPECTED_PEAK_KEPT,
 
   // src: https://mesonbuild.com/Unit-tests.html#skipped-tests-and-hard-errors
   // For the default exitcode testing protocol, the GNU standard approach in
@@ -25,6 +48,163 @@ enum memory_test_error {
   MESON_TEST_FAILED_TO_SET_UP = 99,
 };
 
+static u64 Now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((u64)ts.tv_sec * 1000000000 /* 1e9 */) + (u64)ts.tv_nsec;
+}
+
+#define BENCHMARK_SLOT_SIZE 16
+#define BENCHMARK_ITERATION_COUNT 256
+
+static void BenchmarkReport(struct string_builder *stringBuilder,
+                            struct string *name, u64 slotCount, u64 elapsed) {
+  StringBuilderAppendString(stringBuilder, name);
+  StringBuilderAppendString(stringBuilder, &STRING_FROM_ZERO_TERMINATED(" "));
+  StringBuilderAppendU64(stringBuilder, slotCount);
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED(" slots "));
+  StringBuilderAppendF32(
+      stringBuilder, (f32)elapsed / (f32)(BENCHMARK_ITERATION_COUNT * 2), 2);
+  StringBuilderAppendString(stringBuilder,
+                            &STRING_FROM_ZERO_TERMINATED(" ns/op\n"));
+  struct string string = StringBuilderFlush(stringBuilder);
+  write(STDOUT_FILENO, string.value, string.length);
+}
+
+#define SCRATCH_THREAD_COUNT 8
+#define SCRATCH_ITERATION_COUNT 4096
+
+struct scratch_thread {
+  pthread_t thread;
+  u8 value;
+  // blocks of scratch arenas thread used
+  void *blocks[MEMORY_SCRATCH_COUNT];
+  enum memory_test_error errorCode;
+};
+
+/*
+ * Fills scratch memory with pattern, so threads or nested scopes that share
+ * memory overwrite each other.
+ */
+static u8 *ScratchFill(struct memory_arena *arena, u64 size, u8 value) {
+  u8 *data = MemoryArenaPush(arena, size, 8);
+  memset(data, value, size);
+  return data;
+}
+
+static b8 IsScratchFilled(u8 *data, u64 size, u8 value) {
+  for (u64 index = 0; index < size; index++) {
+    if (data[index] != value)
+      return 0;
+  }
+  return 1;
+}
+
+static enum memory_test_error ScratchIteration(struct scratch_thread *thread,
+                                               u32 iteration) {
+  u64 size = 64 + (iteration * 7919) % 4096;
+  MEMORY_SCRATCH_SCOPE(outer, 0);
+  u8 *outerData = ScratchFill(outer.arena, size, thread->value);
+
+  u8 *result;
+  {
+    // callee that returns result in outer arena
+    MEMORY_SCRATCH_SCOPE(inner, outer.arena);
+    if (inner.arena == outer.arena)
+      return MEMORY_TEST_ERROR_MEM_SCRATCH_EXPECTED_OTHER_ARENA_ON_CONFLICT;
+    thread->blocks[0] = outer.arena->block;
+    thread->blocks[1] = inner.arena->block;
+
+    ScratchFill(inner.arena, size * 2, (u8)~thread->value);
+    result = ScratchFill(outer.arena, size, thread->value);
+  }
+
+  {
+    // nested scope on same arena
+    u64 used = outer.arena->used;
+    {
+      MEMORY_SCRATCH_SCOPE(nested, 0);
+      ScratchFill(nested.arena, size, (u8)~thread->value);
+    }
+    if (outer.arena->used != used)
+      return MEMORY_TEST_ERROR_MEM_SCRATCH_EXPECTED_RELEASE_AT_SCOPE_END;
+  }
+
+  if (!IsScratchFilled(outerData, size, thread->value) ||
+      !IsScratchFilled(result, size, thread->value))
+    return MEMORY_TEST_ERROR_MEM_SCRATCH_EXPECTED_NO_OVERWRITE;
+
+  return MEMORY_TEST_ERROR_NONE;
+}
+
+static void *ScratchThreadMain(void *data) {
+  struct scratch_thread *thread = data;
+  for (u32 iteration = 0; iteration < SCRATCH_ITERATION_COUNT; iteration++) {
+    thread->errorCode = ScratchIteration(thread, iteration);
+    if (thread->errorCode != MEMORY_TEST_ERROR_NONE)
+      return 0;
+  }
+
+  for (u32 index = 0; index < MEMORY_SCRATCH_COUNT; index++) {
+    if (MemoryScratchArenas[index].used != 0)
+      thread->errorCode =
+          MEMORY_TEST_ERROR_MEM_SCRATCH_EXPECTED_RELEASE_AT_SCOPE_END;
+  }
+
+  // blocks are compared after every thread exits, so keep them reserved
+  return 0;
+}
+
+/*
+ * Every slot is used, then one slot at pseudo random index is popped and
+ * pushed again. Measures pop + push pairs.
+ */
+static void Benchmark(struct string_builder *stringBuilder,
+                      struct memory_arena *arena, u64 slotCount) {
+  // memory_chunk
+  {
+    struct memory_temp tempMemory = MemoryTempBegin(arena);
+    struct memory_chunk *chunk =
+        MemoryArenaPushChunk(arena, BENCHMARK_SLOT_SIZE, slotCount);
+    // same as pushing every slot, without O(n^2) setup
+    memset(chunk->block, 1, slotCount);
+
+    u64 startedAt = Now();
+    for (u64 iteration = 0; iteration < BENCHMARK_ITERATION_COUNT;
+         iteration++) {
+      u64 index = (iteration * 7919) % slotCount;
+      MemoryChunkPop(chunk, MemoryChunkGetDataAt(chunk, index));
+      MemoryChunkPush(chunk);
+    }
+    u64 elapsed = Now() - startedAt;
+    BenchmarkReport(stringBuilder, &STRING_FROM_ZERO_TERMINATED("MemoryChunk"),
+                    slotCount, elapsed);
+    MemoryTempEnd(&tempMemory);
+  }
+
+  // memory_pool
+  {
+    struct memory_temp tempMemory = MemoryTempBegin(arena);
+    struct memory_pool pool;
+    MemoryArenaPushPool(arena, &pool, BENCHMARK_SLOT_SIZE, slotCount);
+    for (u64 index = 0; index < slotCount; index++)
+      MemoryPoolPush(&pool);
+
+    u64 startedAt = Now();
+    for (u64 iteration = 0; iteration < BENCHMARK_ITERATION_COUNT;
+         iteration++) {
+      u64 index = (iteration * 7919) % slotCount;
+      MemoryPoolPop(&pool, MemoryPoolGetDataAt(&pool, index));
+      MemoryPoolPush(&pool);
+    }
+    u64 elapsed = Now() - startedAt;
+    BenchmarkReport(stringBuilder, &STRING_FROM_ZERO_TERMINATED("MemoryPool"),
+                    slotCount, elapsed);
+    MemoryTempEnd(&tempMemory);
+  }
+}
+
 int main(void) {
   enum memory_test_error errorCode = MEMORY_TEST_ERROR_NONE;
   struct memory_arena memory;
@@ -63,6 +243,32 @@ int main(void) {
   }
   MemoryTempEnd(&tempMemory);
 
+#if IS_MEMORY_STATS_ENABLED
+  // memory_arena_stats
+  {
+    struct memory_arena statsMemory = {.block = memory.block,
+                                       .total = memory.total};
+    tempMemory = MemoryTempBegin(&statsMemory);
+    struct memory_temp nestedMemory = MemoryTempBegin(&statsMemory);
+    MemoryArenaPush(&statsMemory, 3, 1);
+    MemoryArenaPush(&statsMemory, 8, 8);
+    struct memory_arena_stats *stats = &statsMemory.stats;
+    if (stats->pushCount != 2 || stats->alignmentWaste != 5 ||
+        stats->tempDepthMax != 2) {
+      errorCode = MEMORY_TEST_ERROR_MEM_STATS_EXPECTED_PUSH_COUNTED;
+      goto end;
+    }
+
+    MemoryTempEnd(&nestedMemory);
+    MemoryTempEnd(&tempMemory);
+    if (statsMemory.used != 0 || stats->usedMax != 16 ||
+        stats->tempDepth != 0) {
+      errorCode = MEMORY_TEST_ERROR_MEM_STATS_EXPECTED_PEAK_KEPT;
+      goto end;
+    }
+  }
+#endif
+
   // MemoryChunkPush(struct memory_chunk *chunk)
   tempMemory = MemoryTempBegin(&memory);
   {
@@ -133,6 +339,216 @@ int main(void) {
   }
   MemoryTempEnd(&tempMemory);
 
+  // MemoryPoolPush(struct memory_pool *pool)
+  // MemoryPoolPop(struct memory_pool *pool, void *block)
+  tempMemory = MemoryTempBegin(&memory);
+  {
+    // spans 3 words, last one partially
+    u64 max = 130;
+    struct memory_pool pool;
+    MemoryArenaPushPool(&memory, &pool, 4, max);
+
+    for (u64 index = 0; index < max; index++) {
+      void *expected = (u8 *)pool.block + index * 4;
+      void *value = MemoryPoolPush(&pool);
+      if (value != expected || !MemoryPoolIsDataAvailableAt(&pool, index)) {
+        errorCode = MEMORY_TEST_ERROR_MEM_POOL_PUSH_EXPECTED_VALID_ADDRESS;
+        goto end;
+      }
+    }
+
+    if (MemoryPoolPush(&pool) != 0) {
+      errorCode = MEMORY_TEST_ERROR_MEM_POOL_PUSH_EXPECTED_NULL;
+      goto end;
+    }
+
+    // - lowest free slot is reused first, even across words
+    MemoryPoolPop(&pool, MemoryPoolGetDataAt(&pool, 129));
+    MemoryPoolPop(&pool, MemoryPoolGetDataAt(&pool, 70));
+    MemoryPoolPop(&pool, MemoryPoolGetDataAt(&pool, 3));
+    if (MemoryPoolIsDataAvailableAt(&pool, 70) ||
+        !MemoryPoolIsDataAvailableAt(&pool, 71)) {
+      errorCode = MEMORY_TEST_ERROR_MEM_POOL_EXPECTED_DATA_AVAILABLE;
+      goto end;
+    }
+    if (MemoryPoolPush(&pool) != MemoryPoolGetDataAt(&pool, 3) ||
+        MemoryPoolPush(&pool) != MemoryPoolGetDataAt(&pool, 70) ||
+        MemoryPoolPush(&pool) != MemoryPoolGetDataAt(&pool, 129) ||
+        MemoryPoolPush(&pool) != 0) {
+      errorCode = MEMORY_TEST_ERROR_MEM_POOL_POP_EXPECTED_LOWEST_ADDRESS;
+      goto end;
+    }
+  }
+  MemoryTempEnd(&tempMemory);
+
+  // MemoryArenaReserve(struct memory_arena *arena, u64 size, u32 flags)
+  {
+    u64 MEGABYTES = 1 << 20;
+    struct memory_arena reserved;
+    if (!MemoryArenaReserve(&reserved, 1024 * MEGABYTES, 0)) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+
+    if (reserved.committed != 0 ||
+        !(reserved.flags & MEMORY_ARENA_GROWABLE)) {
+      errorCode = MEMORY_TEST_ERROR_MEM_RESERVE_EXPECTED_NOTHING_COMMITTED;
+      goto end;
+    }
+
+    // - pages are committed as arena grows
+    u8 *first = MemoryArenaPush(&reserved, 100, 1);
+    if (first == 0 || reserved.committed != MEMORY_ARENA_COMMIT_SIZE) {
+      errorCode = MEMORY_TEST_ERROR_MEM_RESERVE_PUSH_EXPECTED_COMMIT_ON_DEMAND;
+      goto end;
+    }
+    first[99] = 0xaa;
+
+    u64 size = 3 * MEMORY_ARENA_COMMIT_SIZE + 1;
+    u8 *second = MemoryArenaPush(&reserved, size, 1);
+    if (second == 0 || reserved.committed < reserved.used) {
+      errorCode = MEMORY_TEST_ERROR_MEM_RESERVE_PUSH_EXPECTED_COMMIT_ON_DEMAND;
+      goto end;
+    }
+    bzero(second, size);
+
+    // - sub arena shares page with master, committing must keep its data
+    struct memory_arena sub = MemoryArenaSub(&reserved, 64 * MEGABYTES);
+    u8 *subData = MemoryArenaPush(&sub, 16 * MEGABYTES, 1);
+    if (subData == 0 || sub.committed < sub.used) {
+      errorCode = MEMORY_TEST_ERROR_MEM_RESERVE_PUSH_EXPECTED_COMMIT_ON_DEMAND;
+      goto end;
+    }
+    subData[16 * MEGABYTES - 1] = 0xbb;
+    if (first[99] != 0xaa) {
+      errorCode = MEMORY_TEST_ERROR_MEM_RESERVE_SUB_EXPECTED_MASTER_DATA_KEPT;
+      goto end;
+    }
+
+    // - pages of sub are left to sub
+    u64 committedBefore = reserved.committed - reserved.subCommitted;
+    if (MemoryArenaPush(&reserved, 100, 1) == 0 ||
+        reserved.committed - reserved.subCommitted >
+            committedBefore + MEMORY_ARENA_COMMIT_SIZE) {
+      errorCode =
+          MEMORY_TEST_ERROR_MEM_RESERVE_SUB_EXPECTED_NOT_COMMITTED_BY_MASTER;
+      goto end;
+    }
+
+    // - push past reservation fails in every build
+    u64 usedBefore = reserved.used;
+    if (MemoryArenaPush(&reserved, reserved.total, 1) != 0 ||
+        MemoryArenaPushUnaligned(&reserved, reserved.total) != 0 ||
+        reserved.used != usedBefore) {
+      errorCode = MEMORY_TEST_ERROR_MEM_RESERVE_PUSH_EXPECTED_NULL_WHEN_FULL;
+      goto end;
+    }
+
+    // MemoryArenaDecommit(struct memory_arena *arena, u64 size)
+    struct memory_temp subMemory = MemoryTempBegin(&sub);
+    u8 *subTemp = MemoryArenaPush(&sub, 8 * MEGABYTES, 1);
+    if (subTemp == 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+    subTemp[4 * MEGABYTES] = 0xcc;
+    MemoryTempEnd(&subMemory);
+    MemoryArenaDecommit(&sub, sub.used);
+    if (sub.committed > sub.used + 4096 ||
+        subData[16 * MEGABYTES - 1] != 0xbb) {
+      errorCode = MEMORY_TEST_ERROR_MEM_DECOMMIT_EXPECTED_COMMIT_AGAIN;
+      goto end;
+    }
+
+    // - pages given back read as zero when committed again
+    subTemp = MemoryArenaPush(&sub, 8 * MEGABYTES, 1);
+    if (subTemp == 0 || subTemp[4 * MEGABYTES] != 0 ||
+        sub.committed < sub.used) {
+      errorCode = MEMORY_TEST_ERROR_MEM_DECOMMIT_EXPECTED_COMMIT_AGAIN;
+      goto end;
+    }
+
+    munmap(reserved.block, reserved.total);
+  }
+
+  // MemoryScratchBegin(struct memory_arena *conflict)
+  // - N threads use their own scratch arenas without locks
+  {
+    struct scratch_thread threads[SCRATCH_THREAD_COUNT] = {};
+    u32 threadCount = 0;
+    for (; threadCount < SCRATCH_THREAD_COUNT; threadCount++) {
+      struct scratch_thread *thread = threads + threadCount;
+      thread->value = (u8)(threadCount + 1);
+      if (pthread_create(&thread->thread, 0, ScratchThreadMain, thread) != 0)
+        break;
+    }
+    for (u32 index = 0; index < threadCount; index++)
+      pthread_join(threads[index].thread, 0);
+    if (threadCount != SCRATCH_THREAD_COUNT) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+
+    for (u32 index = 0; index < threadCount; index++) {
+      struct scratch_thread *thread = threads + index;
+      if (thread->errorCode != MEMORY_TEST_ERROR_NONE) {
+        errorCode = thread->errorCode;
+        goto end;
+      }
+
+      for (u32 otherIndex = 0; otherIndex < index; otherIndex++) {
+        struct scratch_thread *other = threads + otherIndex;
+        for (u32 blockIndex = 0; blockIndex < MEMORY_SCRATCH_COUNT;
+             blockIndex++) {
+          if (thread->blocks[blockIndex] == other->blocks[0] ||
+              thread->blocks[blockIndex] == other->blocks[1]) {
+            errorCode = MEMORY_TEST_ERROR_MEM_SCRATCH_EXPECTED_ARENA_PER_THREAD;
+            goto end;
+          }
+        }
+      }
+    }
+
+    // - release gives address space back
+    MemoryScratchBegin(0);
+    MemoryScratchRelease();
+    if (MemoryScratchArenas[0].block != 0) {
+      errorCode = MEMORY_TEST_ERROR_MEM_SCRATCH_EXPECTED_RELEASE_AT_SCOPE_END;
+      goto end;
+    }
+  }
+
+  // benchmark MemoryChunk against MemoryPool
+  {
+    u64 MEGABYTES = 1 << 20;
+    u64 total = 64 * MEGABYTES;
+    struct memory_arena benchmarkMemory = {
+        .block = mmap(0, total, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0),
+        .total = total,
+    };
+    if (benchmarkMemory.block == MAP_FAILED) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+
+    u8 outBufferValue[128];
+    u8 stringBufferValue[32];
+    struct string outBuffer = {.value = outBufferValue,
+                               .length = sizeof(outBufferValue)};
+    struct string stringBuffer = {.value = stringBufferValue,
+                                  .length = sizeof(stringBufferValue)};
+    struct string_builder stringBuilder = {
+        .outBuffer = &outBuffer,
+        .stringBuffer = &stringBuffer,
+    };
+
+    for (u64 slotCount = 1 << 10; slotCount <= 1 << 20; slotCount <<= 2)
+      Benchmark(&stringBuilder, &benchmarkMemory, slotCount);
+
+    munmap(benchmarkMemory.block, total);
+  }
+
 end:
   return (int)errorCode;
 }
@@ -0,0 +1,205 @@
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "profiler.h"
+
+// TODO: Show error pretty error message when a test fails
+enum profiler_test_error {
+  PROFILER_TEST_ERROR_NONE = 0,
+  PROFILER_TEST_ERROR_RECORD_EXPECTED_EVENTS_IN_ORDER,
+  PROFILER_TEST_ERROR_RECORD_EXPECTED_RING_WRAP,
+  PROFILER_TEST_ERROR_THREAD_EXPECTED_OWN_RING,
+  PROFILER_TEST_ERROR_THREAD_EXPECTED_NO_RING_WHEN_EXHAUSTED,
+  PROFILER_TEST_ERROR_EXPORT_EXPECTED_JSON,
+  PROFILER_TEST_ERROR_EXPORT_EXPECTED_ZONE,
+  PROFILER_TEST_ERROR_EXPORT_EXPECTED_UNMATCHED_END_DROPPED,
+
+  // src: https://mesonbuild.com/Unit-tests.html#skipped-tests-and-hard-errors
+  // For the default exitcode testing protocol, the GNU standard approach in
+  // this case is to exit the program with error code 77. Meson will detect this
+  // and report these tests as skipped rather than failed. This behavior was
+  // added in version 0.37.0.
+  MESON_TEST_SKIP = 77,
+  // In addition, sometimes a test fails set up so that it should fail even if
+  // it is marked as an expected failure. The GNU standard approach in this case
+  // is to exit the program with error code 99. Again, Meson will detect this
+  // and report these tests as ERROR, ignoring the setting of should_fail. This
+  // behavior was added in version 0.50.0.
+  MESON_TEST_FAILED_TO_SET_UP = 99,
+};
+
+#define EVENT_COUNT 8
+
+static void *RecordOnThread(void *data) {
+  ProfilerRecord(PROFILER_EVENT_BEGIN, "thread");
+  ProfilerRecord(PROFILER_EVENT_END, "thread");
+  return ProfilerThreadRing;
+}
+
+static u64 CountOccurrences(struct string *string, struct string *search) {
+  u64 count = 0;
+  for (u64 index = 0; index + search->length <= string->length; index++) {
+    if (memcmp(string->value + index, search->value, search->length) == 0)
+      count++;
+  }
+  return count;
+}
+
+/*
+ * Exports profiler into memory file and reads it back.
+ * @return empty string on failure
+ */
+static struct string Export(struct profiler *profiler,
+                            struct string_builder *builder,
+                            struct string *buffer) {
+  struct string result = {.value = buffer->value};
+  int fd = memfd_create("profiler_test", 0);
+  if (fd == -1)
+    return result;
+
+  ProfilerExportChromeTrace(profiler, builder, fd);
+  ssize_t length = pread(fd, buffer->value, buffer->length, 0);
+  close(fd);
+  if (length > 0)
+    result.length = (u64)length;
+  return result;
+}
+
+int main(void) {
+  enum profiler_test_error errorCode = PROFILER_TEST_ERROR_NONE;
+  struct memory_arena memory;
+
+  {
+    u64 KILOBYTES = 1 << 10;
+    u64 total = 32 * KILOBYTES;
+    memory = (struct memory_arena){.block = alloca(total), .total = total};
+    if (memory.block == 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+    bzero(memory.block, memory.total);
+  }
+
+  struct profiler profiler;
+  ProfilerInit(&profiler, &memory, 2, EVENT_COUNT);
+
+  struct string_builder builder;
+  struct string outBuffer = {.value = MemoryArenaPush(&memory, 512, 1),
+                             .length = 512};
+  struct string stringBuffer = {.value = MemoryArenaPush(&memory, 32, 1),
+                                .length = 32};
+  builder = (struct string_builder){.outBuffer = &outBuffer,
+                                    .stringBuffer = &stringBuffer};
+
+  struct string exportBuffer = {.value = MemoryArenaPush(&memory, 8192, 1),
+                                .length = 8192};
+
+  // ProfilerRecord(enum profiler_event_type type, const char *name)
+  {
+    ProfilerRecord(PROFILER_EVENT_BEGIN, "outer");
+    ProfilerRecord(PROFILER_EVENT_BEGIN, "inner");
+    ProfilerRecord(PROFILER_EVENT_END, "inner");
+    ProfilerRecord(PROFILER_EVENT_END, "outer");
+
+    struct profiler_ring *ring = ProfilerThreadRing;
+    if (ring != profiler.rings + 0 || ring->writeIndex != 4 ||
+        ring->events[0].type != PROFILER_EVENT_BEGIN ||
+        ring->events[1].name[0] != 'i' ||
+        ring->events[3].type != PROFILER_EVENT_END ||
+        ring->events[0].tick > ring->events[3].tick) {
+      errorCode = PROFILER_TEST_ERROR_RECORD_EXPECTED_EVENTS_IN_ORDER;
+      goto end;
+    }
+  }
+
+  // ProfilerExportChromeTrace(struct profiler *profiler,
+  //                           struct string_builder *stringBuilder, int fd)
+  {
+    struct string exported = Export(&profiler, &builder, &exportBuffer);
+    if (exported.length == 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+
+    struct string begin = STRING_FROM_ZERO_TERMINATED("{\"traceEvents\":[");
+    struct string end = STRING_FROM_ZERO_TERMINATED("]}\n");
+    if (!IsStringStartsWith(&exported, &begin) ||
+        exported.length < end.length ||
+        memcmp(exported.value + exported.length - end.length, end.value,
+               end.length) != 0) {
+      errorCode = PROFILER_TEST_ERROR_EXPORT_EXPECTED_JSON;
+      goto end;
+    }
+
+    struct string zone = STRING_FROM_ZERO_TERMINATED(
+        "{\"name\":\"inner\",\"ph\":\"B\",\"ts\":");
+    if (CountOccurrences(&exported, &zone) != 1) {
+      errorCode = PROFILER_TEST_ERROR_EXPORT_EXPECTED_ZONE;
+      goto end;
+    }
+  }
+
+  // oldest events are overwritten
+  {
+    ProfilerRecord(PROFILER_EVENT_BEGIN, "outer");
+    ProfilerRecord(PROFILER_EVENT_BEGIN, "inner");
+    ProfilerRecord(PROFILER_EVENT_END, "inner");
+    for (u32 index = 0; index < EVENT_COUNT / 2 - 1; index++) {
+      ProfilerRecord(PROFILER_EVENT_BEGIN, "wrap");
+      ProfilerRecord(PROFILER_EVENT_END, "wrap");
+    }
+    ProfilerRecord(PROFILER_EVENT_END, "outer");
+
+    struct profiler_ring *ring = ProfilerThreadRing;
+    if (ring->writeIndex != 4 + EVENT_COUNT + 2) {
+      errorCode = PROFILER_TEST_ERROR_RECORD_EXPECTED_RING_WRAP;
+      goto end;
+    }
+
+    // both "inner" end and "outer" end lost their begin events
+    struct string exported = Export(&profiler, &builder, &exportBuffer);
+    if (exported.length == 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+
+    struct string beginEvent = STRING_FROM_ZERO_TERMINATED("\"ph\":\"B\"");
+    struct string endEvent = STRING_FROM_ZERO_TERMINATED("\"ph\":\"E\"");
+    u64 beginCount = CountOccurrences(&exported, &beginEvent);
+    u64 endCount = CountOccurrences(&exported, &endEvent);
+    if (beginCount != EVENT_COUNT / 2 - 1 ||
+        endCount != EVENT_COUNT / 2 - 1) {
+      errorCode = PROFILER_TEST_ERROR_EXPORT_EXPECTED_UNMATCHED_END_DROPPED;
+      goto end;
+    }
+  }
+
+  // each thread records into its own ring
+  {
+    pthread_t thread;
+    void *ring;
+
+    if (pthread_create(&thread, 0, RecordOnThread, 0) != 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+    pthread_join(thread, &ring);
+    if (ring != profiler.rings + 1 || profiler.rings[1].writeIndex != 2) {
+      errorCode = PROFILER_TEST_ERROR_THREAD_EXPECTED_OWN_RING;
+      goto end;
+    }
+
+    if (pthread_create(&thread, 0, RecordOnThread, 0) != 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+    pthread_join(thread, &ring);
+    if (ring != 0) {
+      errorCode = PROFILER_TEST_ERROR_THREAD_EXPECTED_NO_RING_WHEN_EXHAUSTED;
+      goto end;
+    }
+  }
+
+end:
+  return (int)errorCode;
+}
@@ -0,0 +1,182 @@
+#include <string.h>
+
+#include "StringBuilder.h"
+
+// TODO: Show error pretty error message when a test fails
+enum string_builder_test_error {
+  STRING_BUILDER_TEST_ERROR_NONE = 0,
+  STRING_BUILDER_TEST_ERROR_APPEND_EXPECTED_VALUE,
+  STRING_BUILDER_TEST_ERROR_APPEND_EXPECTED_TRUNCATED_WITHOUT_ARENA,
+  STRING_BUILDER_TEST_ERROR_APPEND_EXPECTED_NO_WRITE_PAST_BUFFER,
+  STRING_BUILDER_TEST_ERROR_FLUSH_EXPECTED_RESET,
+  STRING_BUILDER_TEST_ERROR_FLUSH_EXPECTED_TRUNCATED_MARKER,
+  STRING_BUILDER_TEST_ERROR_APPEND_EXPECTED_SPILL_INTO_CHUNKS,
+  STRING_BUILDER_TEST_ERROR_FLUSH_IOVEC_EXPECTED_ALL_OUTPUT_IN_ORDER,
+  STRING_BUILDER_TEST_ERROR_APPEND_EXPECTED_TRUNCATED_WHEN_ARENA_FULL,
+
+  // src: https://mesonbuild.com/Unit-tests.html#skipped-tests-and-hard-errors
+  // For the default exitcode testing protocol, the GNU standard approach in
+  // this case is to exit the program with error code 77. Meson will detect this
+  // and report these tests as skipped rather than failed. This behavior was
+  // added in version 0.37.0.
+  MESON_TEST_SKIP = 77,
+  // In addition, sometimes a test fails set up so that it should fail even if
+  // it is marked as an expected failure. The GNU standard approach in this case
+  // is to exit the program with error code 99. Again, Meson will detect this
+  // and report these tests as ERROR, ignoring the setting of should_fail. This
+  // behavior was added in version 0.50.0.
+  MESON_TEST_FAILED_TO_SET_UP = 99,
+};
+
+#define OUT_BUFFER_SIZE 8
+#define GUARD 0xaa
+#define IOVEC_COUNT 8
+
+int main(void) {
+  enum string_builder_test_error errorCode = STRING_BUILDER_TEST_ERROR_NONE;
+  struct memory_arena memory;
+
+  {
+    u64 KILOBYTES = 1 << 10;
+    u64 total = 32 * KILOBYTES;
+    memory = (struct memory_arena){.block = alloca(total), .total = total};
+    if (memory.block == 0) {
+      errorCode = MESON_TEST_FAILED_TO_SET_UP;
+      goto end;
+    }
+    bzero(memory.block, memory.total);
+  }
+
+  // one extra byte to catch writes past outBuffer
+  u8 outBufferValue[OUT_BUFFER_SIZE + 1];
+  u8 stringBufferValue[32];
+  struct string outBuffer = {.value = outBufferValue,
+                             .length = OUT_BUFFER_SIZE};
+  struct string stringBuffer = {.value = stringBufferValue,
+                                .length = sizeof(stringBufferValue)};
+  struct string_builder stringBuilder = {
+      .outBuffer = &outBuffer,
+      .stringBuffer = &stringBuffer,
+  };
+  outBufferValue[OUT_BUFFER_SIZE] = GUARD;
+
+  // StringBuilderAppendString(struct string_builder *stringBuilder,
+  //                           struct string *string)
+  {
+    StringBuilderAppendString(&stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED("ab"));
+    StringBuilderAppendU64(&stringBuilder, 42);
+    struct string string = StringBuilderFlush(&stringBuilder);
+    if (string.length != 4 || memcmp(string.value, "ab42", 4) != 0) {
+      errorCode = STRING_BUILDER_TEST_ERROR_APPEND_EXPECTED_VALUE;
+      goto end;
+    }
+  }
+
+  // output longer than outBuffer without arena is cut
+  {
+    StringBuilderAppendString(&stringBuilder,
+                              &STRING_FROM_ZERO_TERMINATED("0123456789"));
+    if (!stringBuilder.isTruncated) {
+      errorCode =
+          STRING_BUILDER_TEST_ERROR_APPEND_EXPECTED_TRUNCATED_WITHOUT_ARENA;
+      goto end;
+    }
+
+    StringBuilderAppendU64(&stringBuilder, 123456789);
+    if (outBufferValue[OUT_BUFFER_SIZE] != GUARD ||
+        stringBuilder.length != OUT_BUFFER_SIZE) {
+      errorCode =
+          STRING_BUILDER_TEST_ERROR_APPEND_EXPECTED_NO_WRITE_PAST_BUFFER;
+      goto end;
+    }
+
+    struct string string = StringBuilderFlush(&stringBuilder);
+    if (string.length != OUT_BUFFER_SIZE ||
+        memcmp(string.value, "0123", 4) != 0) {
+      errorCode = STRING_BUILDER_TEST_ERROR_FLUSH_EXPECTED_RESET;
+      goto end;
+    }
+    if (memcmp(string.value + 4, STRING_BUILDER_TRUNCATED_MARKER, 4) != 0) {
+      errorCode = STRING_BUILDER_TEST_ERROR_FLUSH_EXPECTED_TRUNCATED_MARKER;
+      goto end;
+    }
+    if (stringBuilder.length != 0 || stringBuilder.isTruncated) {
+      errorCode = STRING_BUILDER_TEST_ERROR_FLUSH_EXPECTED_RESET;
+      goto end;
+    }
+  }
+
+  // StringBuilderFlushIovec(struct string_builder *stringBuilder,
+  //                         struct iovec *iovecs, u32 iovecMax)
+  {
+    struct memory_temp tempMemory = MemoryTempBegin(&memory);
+    stringBuilder.arena = tempMemory.arena;
+
+    // larger than chunk size, so needs more than one chunk
+    u64 expectedLength = STRING_BUILDER_CHUNK_SIZE * 2;
+    u8 *expected = MemoryArenaPush(&memory, expectedLength, 1);
+    for (u64 index = 0; index < expectedLength; index++)
+      expected[index] = (u8)('a' + index % 26);
+
+    StringBuilderAppendBytes(&stringBuilder, expected, 3);
+    StringBuilderAppendBytes(&stringBuilder, expected + 3,
+                             STRING_BUILDER_CHUNK_SIZE);
+    StringBuilderAppendBytes(&stringBuilder,
+                             expected + 3 + STRING_BUILDER_CHUNK_SIZE,
+                             expectedLength - 3 - STRING_BUILDER_CHUNK_SIZE);
+    if (stringBuilder.isTruncated ||
+        StringBuilderLength(&stringBuilder) != expectedLength ||
+        StringBuilderIovecCount(&stringBuilder) < 3 ||
+        outBufferValue[OUT_BUFFER_SIZE] != GUARD) {
+      errorCode = STRING_BUILDER_TEST_ERROR_APPEND_EXPECTED_SPILL_INTO_CHUNKS;
+      goto end;
+    }
+
+    struct iovec iovecs[IOVEC_COUNT];
+    u32 iovecCount = StringBuilderFlushIovec(&stringBuilder, iovecs,
+                                             IOVEC_COUNT);
+    u64 offset = 0;
+    for (u32 index = 0; index < iovecCount; index++) {
+      struct iovec *iovec = iovecs + index;
+      if (offset + iovec->iov_len > expectedLength ||
+          memcmp(iovec->iov_base, expected + offset, iovec->iov_len) != 0) {
+        errorCode =
+            STRING_BUILDER_TEST_ERROR_FLUSH_IOVEC_EXPECTED_ALL_OUTPUT_IN_ORDER;
+        goto end;
+      }
+      offset += iovec->iov_len;
+    }
+    if (offset != expectedLength || StringBuilderLength(&stringBuilder) != 0) {
+      errorCode =
+          STRING_BUILDER_TEST_ERROR_FLUSH_IOVEC_EXPECTED_ALL_OUTPUT_IN_ORDER;
+      goto end;
+    }
+
+    // - arena runs out
+    u64 remaining = memory.total - memory.used;
+    for (u64 index = 0; index < remaining / 26 + 1; index++)
+      StringBuilderAppendString(
+          &stringBuilder,
+          &STRING_FROM_ZERO_TERMINATED("abcdefghijklmnopqrstuvwxyz"));
+    if (!stringBuilder.isTruncated || memory.used > memory.total) {
+      errorCode =
+          STRING_BUILDER_TEST_ERROR_APPEND_EXPECTED_TRUNCATED_WHEN_ARENA_FULL;
+      goto end;
+    }
+    iovecCount = StringBuilderFlushIovec(&stringBuilder, iovecs, IOVEC_COUNT);
+    struct iovec *lastIovec = iovecs + iovecCount - 1;
+    if (iovecCount == 0 ||
+        memcmp((u8 *)lastIovec->iov_base + lastIovec->iov_len - 4,
+               STRING_BUILDER_TRUNCATED_MARKER, 4) != 0) {
+      errorCode = STRING_BUILDER_TEST_ERROR_FLUSH_EXPECTED_TRUNCATED_MARKER;
+      goto end;
+    }
+
+    stringBuilder.arena = 0;
+    MemoryTempEnd(&tempMemory);
+  }
+
+end:
+  return (int)errorCode;
+}
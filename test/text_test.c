@@ -17,6 +17,8 @@ enum text_test_error {
   TEXT_TEST_ERROR_IS_STRING_STARTS_WITH_EXPECTED_FALSE_2,
   TEXT_TEST_ERROR_IS_STRING_STARTS_WITH_EXPECTED_FALSE_3,
   TEXT_TEST_ERROR_IS_STRING_STARTS_WITH_EXPECTED_FALSE_4,
+  TEXT_TEST_ERROR_STRING_HASH_EXPECTED_FNV1A,
+  TEXT_TEST_ERROR_STRING_HASH_EXPECTED_DIFFERENT,
   TEXT_TEST_ERROR_PARSE_DURATION_EXPECTED_TRUE_1NS,
   TEXT_TEST_ERROR_PARSE_DURATION_EXPECTED_TRUE_1SEC,
   TEXT_TEST_ERROR_PARSE_DURATION_EXPECTED_TRUE_5SEC,
@@ -199,6 +201,29 @@ int main(void) {
     }
   }
 
+  // StringHash(struct string *string)
+  {
+    struct string string;
+
+    string = STRING_FROM_ZERO_TERMINATED("");
+    if (StringHash(&string) != 0xcbf29ce484222325) {
+      errorCode = TEXT_TEST_ERROR_STRING_HASH_EXPECTED_FNV1A;
+      goto end;
+    }
+
+    string = STRING_FROM_ZERO_TERMINATED("a");
+    if (StringHash(&string) != 0xaf63dc4c8601ec8c) {
+      errorCode = TEXT_TEST_ERROR_STRING_HASH_EXPECTED_FNV1A;
+      goto end;
+    }
+
+    struct string other = STRING_FROM_ZERO_TERMINATED("b");
+    if (StringHash(&string) == StringHash(&other)) {
+      errorCode = TEXT_TEST_ERROR_STRING_HASH_EXPECTED_DIFFERENT;
+      goto end;
+    }
+  }
+
   // ParseDuration(struct string *string, struct duration *duration)
   {
     struct string string;